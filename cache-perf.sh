@@ -18,3 +18,13 @@ for cores in 1 2 4 8; do
         ./run-test2.sh 1 $cores $JOBS 2>&1 | grep -E "cache|seconds"
     echo ""
 done
+
+echo "Chained jobs global vs local slot"
+for cores in 1 2 4 8; do
+    for mode in 1 2; do
+        echo "=== Testing with $cores cores, mode $mode ==="
+        perf stat -e cache-references,cache-misses,L1-dcache-load-misses,LLC-load-misses \
+            ./run-test3.sh $cores 64 100 10 $mode 2>&1 | grep -E "Results|cache|seconds"
+        echo ""
+    done
+done
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test10 src/test10.cpp
+#clang++ -std=c++26 -O3 -o test10 src/test10.cpp
+./test10 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test11 src/test11.cpp
+#clang++ -std=c++26 -O3 -o test11 src/test11.cpp
+./test11 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test12 src/test12.cpp
+#clang++ -std=c++26 -O3 -o test12 src/test12.cpp
+./test12 "$@"
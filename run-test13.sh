@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test13 src/test13.cpp
+#clang++ -std=c++26 -O3 -o test13 src/test13.cpp
+./test13 "$@"
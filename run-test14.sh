@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test14 src/test14.cpp
+#clang++ -std=c++26 -O3 -o test14 src/test14.cpp
+./test14 "$@"
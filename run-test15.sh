@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test15 src/test15.cpp
+#clang++ -std=c++26 -O3 -o test15 src/test15.cpp
+./test15 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test16 src/test16.cpp
+#clang++ -std=c++26 -O3 -o test16 src/test16.cpp
+./test16 "$@"
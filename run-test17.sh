@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test17 src/test17.cpp
+#clang++ -std=c++26 -O3 -o test17 src/test17.cpp
+./test17 "$@"
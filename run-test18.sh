@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test18 src/test18.cpp
+#clang++ -std=c++26 -O3 -o test18 src/test18.cpp
+./test18 "$@"
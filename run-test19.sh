@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test19 src/test19.cpp
+#clang++ -std=c++26 -O3 -o test19 src/test19.cpp
+./test19 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test20 src/test20.cpp
+#clang++ -std=c++26 -O3 -o test20 src/test20.cpp
+./test20 "$@"
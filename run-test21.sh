@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test21 src/test21.cpp
+#clang++ -std=c++26 -O3 -o test21 src/test21.cpp
+./test21 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test22 src/test22.cpp
+#clang++ -std=c++26 -O3 -o test22 src/test22.cpp
+./test22 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test23 src/test23.cpp
+#clang++ -std=c++26 -O3 -o test23 src/test23.cpp
+./test23 "$@"
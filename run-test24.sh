@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test24 src/test24.cpp
+#clang++ -std=c++26 -O3 -o test24 src/test24.cpp
+./test24 "$@"
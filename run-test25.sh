@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test25 src/test25.cpp
+#clang++ -std=c++26 -O3 -o test25 src/test25.cpp
+./test25 "$@"
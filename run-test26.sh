@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test26 src/test26.cpp
+#clang++ -std=c++26 -O3 -o test26 src/test26.cpp
+./test26 "$@"
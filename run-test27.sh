@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test27 src/test27.cpp
+#clang++ -std=c++26 -O3 -o test27 src/test27.cpp
+./test27 "$@"
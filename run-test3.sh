@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test3 src/test3.cpp
+#clang++ -std=c++26 -O3 -o test3 src/test3.cpp
+./test3 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test4 src/test4.cpp
+#clang++ -std=c++26 -O3 -o test4 src/test4.cpp
+./test4 "$@"
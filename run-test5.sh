@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test5 src/test5.cpp
+#clang++ -std=c++26 -O3 -o test5 src/test5.cpp
+./test5 "$@"
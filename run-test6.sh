@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test6 src/test6.cpp
+#clang++ -std=c++26 -O3 -o test6 src/test6.cpp
+./test6 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test7 src/test7.cpp
+#clang++ -std=c++26 -O3 -o test7 src/test7.cpp
+./test7 "$@"
@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test8 src/test8.cpp
+#clang++ -std=c++26 -O3 -o test8 src/test8.cpp
+./test8 "$@"
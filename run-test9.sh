@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+
+clang++ -std=c++26 -O3 -fsanitize=thread -o test9 src/test9.cpp
+#clang++ -std=c++26 -O3 -o test9 src/test9.cpp
+./test9 "$@"
@@ -0,0 +1,360 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "kernel.hpp"
+#include "types.hpp"
+
+//
+// size-class heap allocator over `kernel::heap`
+//
+// the heap is cut into 64 KB chunks, each owned by one core and holding
+// blocks of one size class; a core allocates and frees its own blocks through
+// per-core magazines and frees blocks of other cores to the owning chunk's
+// lock-free remote list which the owner collects when its magazine runs dry
+//
+// allocations larger than the largest class take whole chunks
+//
+// usage:
+//   kernel calls `alloc::init(core_count)` at start and defines
+//   `KERNEL_ALLOC_OPERATORS` in one translation unit before including this
+//   header to route `new` and `delete` here
+//
+// thread safety:
+//  * init(): once before any other call
+//  * allocate(), free(): any core; magazines are indexed by
+//    `kernel::core::index`
+//
+// constraints:
+//  * alignment: 16 bytes
+//  * chunks of small classes are kept by their core once used
+//  * must not be used from interrupt handlers (spin lock and per-core state)
+//
+namespace kernel::alloc {
+
+auto constexpr CHUNK_SIZE = 64u * 1024;
+
+// chunk header, blocks follow
+auto constexpr HEADER_SIZE = 2 * core::CACHE_LINE_SIZE;
+
+// block sizes by class
+u32 constexpr SIZES[] = {16,  32,  48,   64,   96,   128,  192,  256,  384,
+                         512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192};
+
+auto constexpr CLASS_COUNT = u32(sizeof(SIZES) / sizeof(SIZES[0]));
+
+// class of chunks of a large allocation
+auto constexpr LARGE = CLASS_COUNT;
+
+// blocks cached per core and class
+auto constexpr MAGAZINE_SIZE = 32u;
+
+// blocks moved between a magazine and chunks at once
+auto constexpr MAGAZINE_BATCH = MAGAZINE_SIZE / 2;
+
+struct Block {
+    Block* next;
+};
+
+struct alignas(core::CACHE_LINE_SIZE) Chunk {
+    u32 owner;
+    u32 size_class;
+    // chunks in this allocation, more than 1 only if `LARGE`
+    u32 run;
+    // next chunk of owner and class, or next free run
+    Chunk* next;
+    // blocks freed by the owner
+    // note: only accessed by owner
+    Block* local;
+    // end of blocks carved so far
+    uptr bump;
+
+    // blocks freed by other cores
+    // note: other cores push, owner takes all
+    alignas(core::CACHE_LINE_SIZE) Block* remote;
+};
+
+static_assert(sizeof(Chunk) == HEADER_SIZE);
+
+struct Magazine {
+    void* blocks[MAGAZINE_SIZE];
+    u32 count;
+};
+
+// state of a core
+// note: only accessed by the owning core, no atomics needed
+struct alignas(core::CACHE_LINE_SIZE) Cache {
+    Magazine magazines[CLASS_COUNT];
+    // chunk blocks are taken from
+    Chunk* current[CLASS_COUNT];
+    // all chunks owned by class
+    Chunk* chunks[CLASS_COUNT];
+};
+
+struct Pool {
+    atomic::Spinlock lock;
+    // never used chunks from `next` to `end`
+    uptr next;
+    uptr end;
+    // freed runs of large allocations
+    Chunk* runs;
+    // per-core state carved from the heap
+    Cache* caches;
+};
+
+// note: guarded by `lock` except `caches`
+Pool inline pool;
+
+// class for sizes up to 1024 by (size + 15) / 16
+u8 inline small_classes[1024 / 16 + 1];
+
+// returns class of `size`, `LARGE` if larger than all classes
+auto inline class_of(usize const size) -> u32 {
+    if (size <= 1024) {
+        return small_classes[(size + 15) / 16];
+    }
+    auto c = 12u;
+    while (c < CLASS_COUNT && SIZES[c] < size) {
+        ++c;
+    }
+    return c;
+}
+
+// returns chunk of block `p`
+auto inline chunk_of(void const* const p) -> Chunk* {
+    return ptr<Chunk>(uptr(p) & ~uptr(CHUNK_SIZE - 1));
+}
+
+// returns `count` contiguous chunks, nullptr if heap exhausted
+auto inline take_chunks(u32 const count) -> Chunk* {
+    pool.lock.lock();
+
+    // first fit in freed runs
+    for (auto** link = &pool.runs; *link; link = &(*link)->next) {
+        auto* const run = *link;
+        if (run->run < count) {
+            continue;
+        }
+        if (run->run == count) {
+            *link = run->next;
+        } else {
+            // take the tail of the run
+            run->run -= count;
+            auto* const tail = ptr_offset<Chunk>(run, u64(run->run) * CHUNK_SIZE);
+            pool.lock.unlock();
+            return tail;
+        }
+        pool.lock.unlock();
+        return run;
+    }
+
+    auto* chunk = ptr<Chunk>(pool.next);
+    if (pool.end - pool.next < u64(count) * CHUNK_SIZE) {
+        chunk = nullptr;
+    } else {
+        pool.next += u64(count) * CHUNK_SIZE;
+    }
+
+    pool.lock.unlock();
+    return chunk;
+}
+
+// returns `count` chunks starting at `chunk` to the pool
+auto inline give_chunks(Chunk* const chunk, u32 const count) -> void {
+    pool.lock.lock();
+    chunk->run = count;
+    chunk->next = pool.runs;
+    pool.runs = chunk;
+    pool.lock.unlock();
+}
+
+// returns a block of chunk `c` owned by the calling core, nullptr if full
+auto inline take_block(Chunk& c) -> void* {
+    if (c.local == nullptr && atomic::load(&c.remote, atomic::RELAXED)) {
+        // (2) paired with release (1)
+        c.local = atomic::exchange<Block*>(&c.remote, nullptr, atomic::ACQUIRE);
+    }
+    if (c.local) {
+        auto* const block = c.local;
+        c.local = block->next;
+        return block;
+    }
+
+    auto const size = SIZES[c.size_class];
+    if (c.bump + size <= uptr(&c) + CHUNK_SIZE) {
+        auto* const block = ptr<void>(c.bump);
+        c.bump += size;
+        return block;
+    }
+
+    return nullptr;
+}
+
+// fills half the magazine of class `cls` for core `core_index`
+// returns:
+//   false if heap exhausted
+auto inline refill(u32 const core_index, u32 const cls) -> bool {
+    auto& cache = pool.caches[core_index];
+    auto& magazine = cache.magazines[cls];
+
+    while (magazine.count < MAGAZINE_BATCH) {
+        auto* chunk = cache.current[cls];
+        auto* block = chunk ? take_block(*chunk) : nullptr;
+        if (block) {
+            magazine.blocks[magazine.count++] = block;
+            continue;
+        }
+
+        // find an owned chunk with free blocks
+        for (chunk = cache.chunks[cls]; chunk; chunk = chunk->next) {
+            if (chunk->local || atomic::load(&chunk->remote, atomic::RELAXED) ||
+                chunk->bump + SIZES[cls] <= uptr(chunk) + CHUNK_SIZE) {
+                break;
+            }
+        }
+
+        if (chunk == nullptr) {
+            chunk = take_chunks(1);
+            if (chunk == nullptr) {
+                return magazine.count != 0;
+            }
+            chunk->owner = core_index;
+            chunk->size_class = cls;
+            chunk->run = 1;
+            chunk->local = nullptr;
+            chunk->bump = uptr(chunk) + HEADER_SIZE;
+            chunk->remote = nullptr;
+            chunk->next = cache.chunks[cls];
+            cache.chunks[cls] = chunk;
+        }
+
+        cache.current[cls] = chunk;
+    }
+
+    return true;
+}
+
+// builds the pool over `kernel::heap` for `core_count` cores
+// returns:
+//   false if heap too small
+auto inline init(u32 const core_count) -> bool {
+    for (auto i = 0u; i <= 1024 / 16; ++i) {
+        auto c = 0u;
+        while (SIZES[c] < i * 16) {
+            ++c;
+        }
+        small_classes[i] = u8(c);
+    }
+
+    auto const start = uptr(heap.start);
+    auto const end = start + heap.size;
+
+    // per-core state at start of heap
+    auto const caches_size = u64(core_count) * sizeof(Cache);
+    auto const caches =
+        (start + core::CACHE_LINE_SIZE - 1) & ~uptr(core::CACHE_LINE_SIZE - 1);
+    auto const first =
+        (caches + caches_size + CHUNK_SIZE - 1) & ~uptr(CHUNK_SIZE - 1);
+    if (first + CHUNK_SIZE > end) {
+        return false;
+    }
+
+    pool.caches = ptr<Cache>(caches);
+    memset(pool.caches, 0, caches_size);
+    pool.next = first;
+    pool.end = end;
+    pool.runs = nullptr;
+    return true;
+}
+
+// returns block of at least `size` bytes, nullptr if heap exhausted
+auto inline allocate(usize const size) -> void* {
+    auto const cls = class_of(size);
+    if (cls == LARGE) {
+        auto const count = u32((size + HEADER_SIZE + CHUNK_SIZE - 1) /
+                               CHUNK_SIZE);
+        auto* const chunk = take_chunks(count);
+        if (chunk == nullptr) {
+            return nullptr;
+        }
+        chunk->size_class = LARGE;
+        chunk->run = count;
+        return ptr_offset<void>(chunk, HEADER_SIZE);
+    }
+
+    auto const core_index = core::index();
+    auto& magazine = pool.caches[core_index].magazines[cls];
+    if (magazine.count == 0 && !refill(core_index, cls)) {
+        return nullptr;
+    }
+    return magazine.blocks[--magazine.count];
+}
+
+// frees block returned by `allocate`
+auto inline free(void* const p) -> void {
+    if (p == nullptr) {
+        return;
+    }
+
+    auto* const chunk = chunk_of(p);
+    auto const cls = chunk->size_class;
+    if (cls == LARGE) {
+        give_chunks(chunk, chunk->run);
+        return;
+    }
+
+    auto const core_index = core::index();
+    if (chunk->owner != core_index) {
+        // push to owner's remote list
+        auto* const block = ptr<Block>(p);
+        auto head = atomic::load(&chunk->remote, atomic::RELAXED);
+        do {
+            block->next = head;
+            // (1) paired with acquire (2)
+        } while (!atomic::compare_exchange(&chunk->remote, &head, block, true,
+                                           atomic::RELEASE, atomic::RELAXED));
+        return;
+    }
+
+    auto& magazine = pool.caches[core_index].magazines[cls];
+    if (magazine.count == MAGAZINE_SIZE) {
+        // return half the magazine to the chunks
+        while (magazine.count > MAGAZINE_SIZE - MAGAZINE_BATCH) {
+            auto* const block = ptr<Block>(magazine.blocks[--magazine.count]);
+            auto* const owner = chunk_of(block);
+            block->next = owner->local;
+            owner->local = block;
+        }
+    }
+    magazine.blocks[magazine.count++] = p;
+}
+
+} // namespace kernel::alloc
+
+#ifdef KERNEL_ALLOC_OPERATORS
+
+auto operator new(usize const size) -> void* {
+    auto* const p = kernel::alloc::allocate(size);
+    if (p == nullptr) {
+        kernel::panic(0xff0000);
+    }
+    return p;
+}
+
+auto operator new[](usize const size) -> void* { return operator new(size); }
+
+auto operator delete(void* const p) noexcept -> void { kernel::alloc::free(p); }
+
+auto operator delete[](void* const p) noexcept -> void {
+    kernel::alloc::free(p);
+}
+
+// note: size is not needed; the chunk header has the class
+auto operator delete(void* const p, usize) noexcept -> void {
+    kernel::alloc::free(p);
+}
+
+auto operator delete[](void* const p, usize) noexcept -> void {
+    kernel::alloc::free(p);
+}
+
+#endif
@@ -59,4 +59,31 @@ auto inline store(T* const target, T const val, i32 const mem_order) -> void {
     __atomic_store_n(target, val, mem_order);
 }
 
+// test-and-test-and-set spin lock
+// note: for short critical sections; waiters spin without yielding
+class Spinlock final {
+    u32 locked_ = 0;
+
+  public:
+    auto lock() -> void {
+        while (!try_lock()) {
+            // note: relaxed spin on the cached line until it is released
+            while (load(&locked_, RELAXED) != 0) {
+                __builtin_ia32_pause();
+            }
+        }
+    }
+
+    // returns true if lock was acquired
+    auto try_lock() -> bool {
+        // (1) paired with release (2)
+        return exchange(&locked_, 1u, ACQUIRE) == 0;
+    }
+
+    auto unlock() -> void {
+        // (2) paired with acquire (1)
+        store(&locked_, 0u, RELEASE);
+    }
+};
+
 } // namespace atomic
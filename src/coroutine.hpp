@@ -0,0 +1,85 @@
+#pragma once
+
+// coroutine support types required by the compiler
+// note: hosted builds use the standard library, the freestanding kernel gets
+//       a minimal implementation over the compiler built-ins
+
+#if __STDC_HOSTED__
+
+#include <coroutine>
+
+#else
+
+namespace std {
+
+template <typename R, typename... Args> struct coroutine_traits {
+    using promise_type = typename R::promise_type;
+};
+
+template <typename Promise = void> struct coroutine_handle;
+
+template <> struct coroutine_handle<void> {
+    constexpr coroutine_handle() noexcept = default;
+    constexpr coroutine_handle(decltype(nullptr)) noexcept {}
+
+    static constexpr auto from_address(void* const p) noexcept
+        -> coroutine_handle {
+        coroutine_handle h;
+        h.frame_ = p;
+        return h;
+    }
+
+    constexpr auto address() const noexcept -> void* { return frame_; }
+
+    constexpr explicit operator bool() const noexcept {
+        return frame_ != nullptr;
+    }
+
+    auto done() const noexcept -> bool { return __builtin_coro_done(frame_); }
+    auto resume() const -> void { __builtin_coro_resume(frame_); }
+    auto operator()() const -> void { resume(); }
+    auto destroy() const -> void { __builtin_coro_destroy(frame_); }
+
+  protected:
+    void* frame_ = nullptr;
+};
+
+template <typename Promise> struct coroutine_handle : coroutine_handle<> {
+    constexpr coroutine_handle() noexcept = default;
+    constexpr coroutine_handle(decltype(nullptr)) noexcept {}
+
+    static constexpr auto from_address(void* const p) noexcept
+        -> coroutine_handle {
+        coroutine_handle h;
+        h.frame_ = p;
+        return h;
+    }
+
+    static auto from_promise(Promise& promise) noexcept -> coroutine_handle {
+        coroutine_handle h;
+        h.frame_ =
+            __builtin_coro_promise(&promise, alignof(Promise), true);
+        return h;
+    }
+
+    auto promise() const -> Promise& {
+        return *static_cast<Promise*>(
+            __builtin_coro_promise(frame_, alignof(Promise), false));
+    }
+};
+
+struct suspend_always {
+    constexpr auto await_ready() const noexcept -> bool { return false; }
+    constexpr auto await_suspend(coroutine_handle<>) const noexcept -> void {}
+    constexpr auto await_resume() const noexcept -> void {}
+};
+
+struct suspend_never {
+    constexpr auto await_ready() const noexcept -> bool { return true; }
+    constexpr auto await_suspend(coroutine_handle<>) const noexcept -> void {}
+    constexpr auto await_resume() const noexcept -> void {}
+};
+
+} // namespace std
+
+#endif
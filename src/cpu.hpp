@@ -0,0 +1,70 @@
+#pragma once
+
+#include "types.hpp"
+
+//
+// processor features detected once at start
+//
+// usage:
+//   kernel calls `cpu::init()` on the bootstrap core before other cores start;
+//   code dispatches on `cpu::features`
+//
+// note: before `init` all features read false so the baseline x86_64 paths
+//       (sse2) are taken
+//
+namespace kernel::cpu {
+
+struct Features {
+    // avx usable: supported and its register state enabled by the kernel
+    bool avx;
+    bool avx2;
+    // enhanced `rep movsb` / `rep stosb`
+    bool erms;
+    // fast short `rep movsb`
+    bool fsrm;
+};
+
+Features inline features;
+
+struct Registers {
+    u32 eax;
+    u32 ebx;
+    u32 ecx;
+    u32 edx;
+};
+
+auto inline cpuid(u32 const leaf, u32 const subleaf) -> Registers {
+    Registers r;
+    asm volatile("cpuid"
+                 : "=a"(r.eax), "=b"(r.ebx), "=c"(r.ecx), "=d"(r.edx)
+                 : "a"(leaf), "c"(subleaf));
+    return r;
+}
+
+// returns extended control register `index`
+// note: only valid if cpuid reports osxsave
+auto inline xgetbv(u32 const index) -> u64 {
+    u32 low;
+    u32 high;
+    asm volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(index));
+    return (u64(high) << 32) | low;
+}
+
+auto inline init() -> void {
+    auto const max_leaf = cpuid(0, 0).eax;
+    auto const leaf1 = cpuid(1, 0);
+
+    // avx needs xmm and ymm state enabled in xcr0
+    auto const osxsave = (leaf1.ecx & (1u << 27)) != 0;
+    auto const ymm = osxsave && (xgetbv(0) & 0b110) == 0b110;
+    features.avx = ymm && (leaf1.ecx & (1u << 28));
+
+    if (max_leaf >= 7) {
+        auto const leaf7 = cpuid(7, 0);
+        features.avx2 = features.avx && (leaf7.ebx & (1u << 5));
+        features.erms = leaf7.ebx & (1u << 9);
+        features.fsrm = leaf7.edx & (1u << 4);
+    }
+}
+
+} // namespace kernel::cpu
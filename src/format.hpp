@@ -0,0 +1,307 @@
+#pragma once
+
+#include "memory.hpp"
+#include "types.hpp"
+
+//
+// integer formatting into caller buffers and format strings checked and
+// split at compile time
+//
+// decimal writes two digits per division using a table of digit pairs after
+// counting the digits without a loop; hex spreads the nibbles of a value over
+// a 16 byte vector and converts them all at once
+//
+// placeholders of format strings:
+//   `{}`  unsigned decimal
+//   `{i}` signed decimal
+//   `{x}` unsigned hex, 16 digits
+//   `{s}` string
+// note: '{' always starts a placeholder
+//
+// the same format string is used for text on the serial port or in log
+// records and for binary log records, see `log::binary`
+//
+// usage:
+//   char text[64];
+//   auto const size = format::to(text, sizeof(text), "{} pages at {x}\n",
+//                                count, address);
+//
+// thread safety:
+//  * all functions: any core, no shared state
+//
+namespace kernel::format {
+
+// u64 max is 20 digits
+auto constexpr DEC_SIZE = 20u;
+
+auto constexpr HEX_SIZE = 16u;
+
+// "00" to "99"
+char constexpr DIGIT_PAIRS[] = "00010203040506070809"
+                               "10111213141516171819"
+                               "20212223242526272829"
+                               "30313233343536373839"
+                               "40414243444546474849"
+                               "50515253545556575859"
+                               "60616263646566676869"
+                               "70717273747576777879"
+                               "80818283848586878889"
+                               "90919293949596979899";
+
+u64 constexpr POWERS_OF_10[DEC_SIZE] = {
+    1ull,
+    10ull,
+    100ull,
+    1000ull,
+    10000ull,
+    100000ull,
+    1000000ull,
+    10000000ull,
+    100000000ull,
+    1000000000ull,
+    10000000000ull,
+    100000000000ull,
+    1000000000000ull,
+    10000000000000ull,
+    100000000000000ull,
+    1000000000000000ull,
+    10000000000000000ull,
+    100000000000000000ull,
+    1000000000000000000ull,
+    10000000000000000000ull,
+};
+
+// returns number of decimal digits of `value`
+auto constexpr digits(u64 const value) -> u32 {
+    // note: setting bit 0 never crosses a power of 10 and makes 0 one digit
+    auto const v = value | 1;
+    // log10 from log2 with log10(2) ~ 1233 / 4096, at most one too small
+    auto const log2 = u32(63 - __builtin_clzll(v));
+    auto const t = ((log2 + 1) * 1233) >> 12;
+    return t + (v >= POWERS_OF_10[t] ? 1 : 0);
+}
+
+// writes `value` in decimal to `out`
+// returns:
+//   number of characters written, at most `DEC_SIZE`
+auto inline dec(char* const out, u64 value) -> u32 {
+    auto const n = digits(value);
+    auto* p = out + n;
+    while (value >= 100) {
+        auto const pair = value % 100;
+        value /= 100;
+        p -= 2;
+        *ptr<memory::u16u>(p) =
+            *ptr<memory::u16u const>(DIGIT_PAIRS + pair * 2);
+    }
+    if (value >= 10) {
+        *ptr<memory::u16u>(p - 2) =
+            *ptr<memory::u16u const>(DIGIT_PAIRS + value * 2);
+    } else {
+        p[-1] = char('0' + value);
+    }
+    return n;
+}
+
+// writes `value` in decimal with a leading '-' if negative to `out`
+// returns:
+//   number of characters written, at most `DEC_SIZE` + 1
+auto inline dec_signed(char* const out, i64 const value) -> u32 {
+    if (value < 0) {
+        out[0] = '-';
+        return dec(out + 1, u64(0) - u64(value)) + 1;
+    }
+    return dec(out, u64(value));
+}
+
+// writes the `HEX_SIZE` hex digits of `value` to `out`
+auto inline hex(char* const out, u64 const value) -> void {
+    // byte i of the big endian value holds digits 2i and 2i + 1
+    auto const bytes = memory::v16b(memory::v16{i64(__builtin_bswap64(value))});
+    auto const high = (bytes >> 4) & 0xf;
+    auto const low = bytes & 0xf;
+    auto const nibbles = __builtin_shufflevector(high, low, 0, 16, 1, 17, 2, 18,
+                                                 3, 19, 4, 20, 5, 21, 6, 22, 7,
+                                                 23);
+    // 'A' follows '9' after 7 other characters
+    *ptr<memory::v16bu>(out) = nibbles + '0' + memory::v16b((nibbles > 9) & 7);
+}
+
+// text being formatted into a caller buffer
+// note: output beyond `capacity` is dropped
+struct Buffer {
+    char* data;
+    u32 capacity;
+    u32 size;
+
+    auto text(char const* const s, u32 const n) -> Buffer& {
+        auto const count = capacity - size < n ? capacity - size : n;
+        memory::copy(data + size, s, count);
+        size += count;
+        return *this;
+    }
+
+    auto text(char const* s) -> Buffer& {
+        while (*s && size < capacity) {
+            data[size++] = *s++;
+        }
+        return *this;
+    }
+
+    auto chr(char const c) -> Buffer& {
+        if (size < capacity) {
+            data[size++] = c;
+        }
+        return *this;
+    }
+
+    auto dec(u64 const value) -> Buffer& {
+        if (capacity - size >= DEC_SIZE) {
+            size += format::dec(data + size, value);
+            return *this;
+        }
+        char digits[DEC_SIZE];
+        return text(digits, format::dec(digits, value));
+    }
+
+    auto dec_signed(i64 const value) -> Buffer& {
+        if (value < 0) {
+            chr('-');
+            return dec(u64(0) - u64(value));
+        }
+        return dec(u64(value));
+    }
+
+    auto hex(u64 const value) -> Buffer& {
+        if (capacity - size >= HEX_SIZE) {
+            format::hex(data + size, value);
+            size += HEX_SIZE;
+            return *this;
+        }
+        char digits[HEX_SIZE];
+        format::hex(digits, value);
+        return text(digits, HEX_SIZE);
+    }
+};
+
+// returns the id of format string `s`: 32 bit fnv-1a of its bytes
+auto constexpr id(char const* s) -> u32 {
+    auto hash = 2166136261u;
+    while (*s) {
+        hash = (hash ^ u8(*s++)) * 16777619u;
+    }
+    return hash;
+}
+
+// not defined; a call from a constant evaluation fails compilation
+auto invalid_format() -> void;
+
+enum class Kind : u8 { UNSIGNED, SIGNED, STRING };
+
+template <typename T> auto consteval kind_of() -> Kind {
+    if constexpr (is_same<T, char const*> || is_same<T, char*>) {
+        return Kind::STRING;
+    } else if constexpr (T(-1) < T(0)) {
+        return Kind::SIGNED;
+    } else {
+        return Kind::UNSIGNED;
+    }
+}
+
+// format string checked against `Args` and split into literal pieces around
+// the placeholders at compile time
+template <typename... Args> struct Format {
+    // note: one more piece than arguments
+    static auto constexpr PIECES = sizeof...(Args) + 1;
+
+    char const* string;
+    u32 id;
+    // piece i is `string[starts[i]]` to `string[ends[i]]`
+    u16 starts[PIECES];
+    u16 ends[PIECES];
+    // placeholder i is `{x}`
+    bool hex[PIECES];
+
+    template <u32 N>
+    consteval Format(char const (&s)[N])
+        : string{s}, id{format::id(s)}, starts{}, ends{}, hex{} {
+        static_assert(N <= 0xffff, "format string too long");
+        Kind const kinds[] = {kind_of<Args>()..., Kind::UNSIGNED};
+
+        auto k = 0u;
+        for (auto i = 0u; i + 1 < N; ++i) {
+            if (s[i] != '{') {
+                continue;
+            }
+            auto const spec = s[i + 1];
+            auto const close = spec == '}' ? i + 1 : i + 2;
+            if (close + 1 >= N || s[close] != '}' || k == sizeof...(Args)) {
+                // placeholder malformed or extra
+                invalid_format();
+            }
+            auto const kind = kinds[k];
+            if (spec == '}' || spec == 'x' ? kind != Kind::UNSIGNED
+                : spec == 'i'              ? kind != Kind::SIGNED
+                : spec == 's'              ? kind != Kind::STRING
+                                           : true) {
+                // placeholder not matching the type of its argument
+                invalid_format();
+            }
+            ends[k] = u16(i);
+            hex[k] = spec == 'x';
+            ++k;
+            starts[k] = u16(close + 1);
+            i = close;
+        }
+        if (k != sizeof...(Args)) {
+            // arguments without placeholder
+            invalid_format();
+        }
+        ends[k] = u16(N - 1);
+    }
+};
+
+// appends argument of a format string
+template <typename T>
+auto inline append(Buffer& buffer, T const value, bool const hex) -> void {
+    if constexpr (kind_of<T>() == Kind::STRING) {
+        buffer.text(value);
+    } else if constexpr (kind_of<T>() == Kind::SIGNED) {
+        buffer.dec_signed(i64(value));
+    } else if (hex) {
+        buffer.hex(u64(value));
+    } else {
+        buffer.dec(u64(value));
+    }
+}
+
+// appends `format` with `args` to `buffer`
+template <typename... Args>
+auto inline append(Buffer& buffer,
+                   typename type_identity<Format<Args...>>::type const& format,
+                   Args const... args) -> void {
+    auto i = 0u;
+    [[maybe_unused]] auto const piece = [&](auto const value) {
+        buffer.text(format.string + format.starts[i],
+                    format.ends[i] - format.starts[i]);
+        append(buffer, value, format.hex[i]);
+        ++i;
+    };
+    (piece(args), ...);
+    buffer.text(format.string + format.starts[i],
+                format.ends[i] - format.starts[i]);
+}
+
+// writes `format` with `args` to the `capacity` bytes at `out`
+// returns:
+//   number of characters written, output beyond `capacity` is dropped
+template <typename... Args>
+auto inline to(char* const out, u32 const capacity,
+               typename type_identity<Format<Args...>>::type const& format,
+               Args const... args) -> u32 {
+    Buffer buffer{out, capacity, 0};
+    append<Args...>(buffer, format, args...);
+    return buffer.size;
+}
+
+} // namespace kernel::format
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "kernel.hpp"
+#include "osca.hpp"
+#include "types.hpp"
+
+namespace osca {
+
+//
+// load-adaptive consumer activation
+//
+// tracks the depth of a queue and keeps consumers with index below
+// `active_consumers` running while the others park; one consumer is activated
+// as soon as depth exceeds `raise` jobs per active consumer and one is parked
+// after depth stayed below `lower` jobs per active consumer for `hold`
+// samples
+//
+// usage:
+//   consumer loop:
+//     if (!jobs.run_next(core_index)) {
+//         if (governor.parked(core_index)) {
+//             governor.park(core_index);
+//         } else {
+//             kernel::core::pause();
+//         }
+//     }
+//   `on_timer` or a monitor thread:
+//     governor.update();
+//
+// thread safety:
+//  * update(): one thread, typically the timer interrupt
+//  * activate_all(): any thread
+//  * parked(), park(): consumer threads
+//  * active_consumers(): any thread
+//
+// note: parked consumers watch the depth themselves and activate the next
+//       consumer without waiting for `update`
+//
+template <typename Queue> class Governor final {
+    // pauses between depth checks of a parked consumer
+    static auto constexpr PARK_SPINS = 64u;
+
+    Queue* queue_;
+    u32 min_;
+    u32 max_;
+    u32 raise_;
+    u32 lower_;
+    u32 hold_;
+    // consecutive samples below `lower_`
+    // note: only accessed by `update`
+    u32 low_samples_;
+
+    // consumers with index below are active
+    // note: read by all consumers, written when activation changes
+    alignas(kernel::core::CACHE_LINE_SIZE) u32 active_;
+
+    // make sure `active_` is alone on cache line
+    u8 padding[kernel::core::CACHE_LINE_SIZE - sizeof(active_)];
+
+  public:
+    // called before consumers start
+    // note: `min` consumers are always active, at most `max`
+    auto init(Queue& queue, u32 const min, u32 const max, u32 const raise,
+              u32 const lower, u32 const hold) -> void {
+        queue_ = &queue;
+        min_ = min;
+        max_ = max;
+        raise_ = raise;
+        lower_ = lower;
+        hold_ = hold;
+        low_samples_ = 0;
+        active_ = max;
+    }
+
+    // samples depth and activates or parks a consumer
+    auto update() -> void {
+        auto const depth = queue_->active_count();
+        auto active = atomic::load(&active_, atomic::RELAXED);
+
+        if (depth > active * raise_) {
+            low_samples_ = 0;
+            activate(active);
+            return;
+        }
+
+        if (depth >= active * lower_ || active <= min_) {
+            low_samples_ = 0;
+            return;
+        }
+
+        ++low_samples_;
+        if (low_samples_ < hold_) {
+            return;
+        }
+        low_samples_ = 0;
+
+        // note: fails if a parked consumer activated meanwhile
+        atomic::compare_exchange(&active_, &active, active - 1, false,
+                                 atomic::RELAXED, atomic::RELAXED);
+    }
+
+    // activates all consumers, for example before a known burst or stopping
+    // consumers
+    // note: `update` parks them again as depth stays low
+    auto activate_all() -> void {
+        atomic::store(&active_, max_, atomic::RELAXED);
+    }
+
+    // returns number of active consumers
+    auto active_consumers() const -> u32 {
+        return atomic::load(&active_, atomic::RELAXED);
+    }
+
+    // returns true if consumer `core_index` should park
+    auto parked(u32 const core_index) const -> bool {
+        return core_index >= atomic::load(&active_, atomic::RELAXED);
+    }
+
+    // called from consumer `core_index` when `parked`
+    // spins with `pause`, yielding the core to its hyper-thread sibling, until
+    // the consumer is active again
+    auto park(u32 const core_index) -> void {
+        while (true) {
+            auto active = atomic::load(&active_, atomic::RELAXED);
+            if (core_index < active) {
+                return;
+            }
+
+            if (queue_->active_count() > active * raise_) {
+                activate(active);
+                continue;
+            }
+
+            for (auto i = 0u; i < PARK_SPINS; ++i) {
+                kernel::core::pause();
+            }
+        }
+    }
+
+  private:
+    // activates one more consumer unless `active` changed or is `max_`
+    auto activate(u32 active) -> void {
+        if (active >= max_) {
+            return;
+        }
+
+        atomic::compare_exchange(&active_, &active, active + 1, false,
+                                 atomic::RELAXED, atomic::RELAXED);
+    }
+};
+
+Governor<decltype(jobs)> inline governor;
+
+} // namespace osca
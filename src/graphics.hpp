@@ -0,0 +1,678 @@
+#pragma once
+
+#include "cpu.hpp"
+#include "kernel.hpp"
+#include "memory.hpp"
+#include "types.hpp"
+
+//
+// off-screen back buffer in normal memory presented to the frame buffer
+//
+// drawing reads and writes the back buffer at cache speed; the frame buffer
+// is write-combined and uncached so it is only written, by `present`, which
+// copies the dirty rectangles with non-temporal stores
+//
+// `fill_rect`, `blend_rect`, `blit`, `blit_blend`, `scale_nearest` and
+// `scale_bilinear` draw on any `FrameBuffer`, for example the back buffer's
+// `surface`, clipping to it
+//
+// usage:
+//   kernel at start:
+//     auto const size = graphics::BackBuffer::size_of(frame_buffer.width,
+//                                                     frame_buffer.height);
+//     graphics::back_buffer.init(allocate_pages((size + 4095) / 4096),
+//                                frame_buffer.width, frame_buffer.height);
+//   drawing:
+//     graphics::back_buffer.fill({10, 10, 110, 30}, 0x00ff0000);
+//     graphics::back_buffer.present(frame_buffer);
+//
+// thread safety:
+//  * one core draws and presents at a time
+//
+// constraints:
+//  * at most `MAX_DIRTY` rectangles are tracked; when full a new one is merged
+//    into the one it grows the least
+//
+namespace kernel::graphics {
+
+// rectangles tracked before merging
+auto constexpr MAX_DIRTY = 16u;
+
+// pixels from `left` to `right` and from `top` to `bottom`, both exclusive
+struct Rect {
+    u32 left;
+    u32 top;
+    u32 right;
+    u32 bottom;
+
+    auto empty() const -> bool { return left >= right || top >= bottom; }
+
+    auto area() const -> u64 {
+        return empty() ? 0 : u64(right - left) * (bottom - top);
+    }
+};
+
+// returns smallest rectangle holding `a` and `b`
+auto inline bounds(Rect const a, Rect const b) -> Rect {
+    return {a.left < b.left ? a.left : b.left, a.top < b.top ? a.top : b.top,
+            a.right > b.right ? a.right : b.right,
+            a.bottom > b.bottom ? a.bottom : b.bottom};
+}
+
+// returns part of `a` inside `b`
+auto inline intersect(Rect const a, Rect const b) -> Rect {
+    return {a.left > b.left ? a.left : b.left, a.top > b.top ? a.top : b.top,
+            a.right < b.right ? a.right : b.right,
+            a.bottom < b.bottom ? a.bottom : b.bottom};
+}
+
+//
+// drawing on a `FrameBuffer`
+//
+// rows go through vector kernels: `_sse` ones on sse2, the x86_64 baseline,
+// and `_avx2` ones when `cpu::features` reports avx2
+//
+
+// pixels of a fill above which it bypasses the caches, see
+// `memory::STREAMING_THRESHOLD`
+auto constexpr STREAMING_PIXELS = memory::STREAMING_THRESHOLD / sizeof(u32);
+
+// vectors of pixels, of their bytes and of their bytes widened
+using u32x4 = u32 __attribute__((vector_size(16)));
+using u32x4u = u32 __attribute__((vector_size(16), aligned(1), may_alias));
+using u32x8 = u32 __attribute__((vector_size(32)));
+using u32x8u = u32 __attribute__((vector_size(32), aligned(1), may_alias));
+using i32x8 = i32 __attribute__((vector_size(32)));
+using u64x2 = u64 __attribute__((vector_size(16)));
+using u8x8 = u8 __attribute__((vector_size(8)));
+using u8x16 = u8 __attribute__((vector_size(16)));
+using u8x32 = u8 __attribute__((vector_size(32)));
+using u16x8 = u16 __attribute__((vector_size(16)));
+using u16x16 = u16 __attribute__((vector_size(32)));
+using u16x32 = u16 __attribute__((vector_size(64)));
+
+// returns `src` with alpha in its top byte blended over `dst`
+// note: the alpha of the result is 0
+auto inline blend(u32 const dst, u32 const src) -> u32 {
+    auto const a = src >> 24;
+    auto result = 0u;
+    for (auto shift = 0u; shift < 24; shift += 8) {
+        auto const s = (src >> shift) & 0xff;
+        auto const d = (dst >> shift) & 0xff;
+        // x / 255 rounded
+        auto const x = s * a + d * (255 - a) + 128;
+        result |= ((x + (x >> 8)) >> 8) << shift;
+    }
+    return result;
+}
+
+// `blend` of vectors of pixels `src` over `dst`; `Bytes` and `Words` hold
+// their bytes and the bytes widened to 16 bits
+// note: exact in 16 bits since s * a + d * (255 - a) + 128 <= 65153
+// note: by reference so that no vector crosses a call of another target
+template <typename Bytes, typename Words, typename Pixels>
+[[gnu::always_inline]] inline auto blend_vector(Pixels& dst, Pixels const& src)
+    -> void {
+    // alpha and 255 - alpha in the color channels, 0 in the alpha channel
+    auto const a = (src >> 24) * 0x010101;
+    auto const inverse = 0xffffff - a;
+
+    auto const x = __builtin_convertvector(Bytes(src), Words) *
+                       __builtin_convertvector(Bytes(a), Words) +
+                   __builtin_convertvector(Bytes(dst), Words) *
+                       __builtin_convertvector(Bytes(inverse), Words) +
+                   128;
+    dst = Pixels(__builtin_convertvector((x + (x >> 8)) >> 8, Bytes));
+}
+
+// fills `n` pixels at `d` with `color`
+auto inline fill_row(u32* const d, u32 const color, u32 const n,
+                     bool const streaming) -> void {
+    auto const pattern = u64(color) * 0x0000000100000001ull;
+    auto const bytes = u64(n) * sizeof(u32);
+    // note: overlapping tails start at multiples of 4 bytes so the pattern
+    //       stays in phase
+    if (bytes <= 16) {
+        memory::fill_small(ptr<u8>(d), pattern, bytes);
+    } else if (streaming && bytes >= 64) {
+        memory::fill_streaming(ptr<u8>(d), pattern, bytes);
+    } else if (bytes > 32 && cpu::features.avx) {
+        memory::fill_avx(ptr<u8>(d), pattern, bytes);
+    } else {
+        memory::fill_sse(ptr<u8>(d), pattern, bytes);
+    }
+}
+
+// blends `n` pixels of `s`, or `color` if `s` is null, over `d`
+auto inline blend_row_sse(u32* d, u32 const* s, u32 const color, u32 n)
+    -> void {
+    auto const c = u32x4{} + color;
+    for (; n >= 4; d += 4, n -= 4) {
+        auto const src = s ? u32x4(*ptr<u32x4u const>(s)) : c;
+        auto dst = u32x4(*ptr<u32x4u const>(d));
+        blend_vector<u8x16, u16x16>(dst, src);
+        *ptr<u32x4u>(d) = dst;
+        s = s ? s + 4 : s;
+    }
+    for (; n; ++d, --n) {
+        *d = blend(*d, s ? *s++ : color);
+    }
+}
+
+[[gnu::target("avx2")]] inline auto blend_row_avx2(u32* d, u32 const* s,
+                                                   u32 const color, u32 n)
+    -> void {
+    auto const c = u32x8{} + color;
+    for (; n >= 8; d += 8, n -= 8) {
+        auto const src = s ? u32x8(*ptr<u32x8u const>(s)) : c;
+        auto dst = u32x8(*ptr<u32x8u const>(d));
+        blend_vector<u8x32, u16x32>(dst, src);
+        *ptr<u32x8u>(d) = dst;
+        s = s ? s + 8 : s;
+    }
+    for (; n; ++d, --n) {
+        *d = blend(*d, s ? *s++ : color);
+    }
+}
+
+auto inline blend_row(u32* const d, u32 const* const s, u32 const color,
+                      u32 const n) -> void {
+    if (cpu::features.avx2) {
+        blend_row_avx2(d, s, color, n);
+    } else {
+        blend_row_sse(d, s, color, n);
+    }
+}
+
+// copies to `n` pixels at `d` pixels `x` >> 16 of `s`, `x` growing by `step`
+// note: sse2 has no gather
+auto inline nearest_row_sse(u32* const d, u32 const* const s, u32 x,
+                            u32 const step, u32 const n) -> void {
+    for (auto i = 0u; i < n; ++i, x += step) {
+        d[i] = s[x >> 16];
+    }
+}
+
+[[gnu::target("avx2")]] inline auto nearest_row_avx2(u32* d,
+                                                     u32 const* const s, u32 x,
+                                                     u32 const step, u32 n)
+    -> void {
+    auto xs = u32x8{0, 1, 2, 3, 4, 5, 6, 7} * step + x;
+    auto const advance = step * 8;
+    for (; n >= 8; d += 8, n -= 8, x += advance) {
+        *ptr<u32x8u>(d) = u32x8(__builtin_ia32_gathersiv8si(
+            i32x8{}, ptr<int const>(s), i32x8(xs >> 16), i32x8{} - 1, 4));
+        xs += advance;
+    }
+    nearest_row_sse(d, s, x, step, n);
+}
+
+auto inline nearest_row(u32* const d, u32 const* const s, u32 const x,
+                        u32 const step, u32 const n) -> void {
+    if (cpu::features.avx2) {
+        nearest_row_avx2(d, s, x, step, n);
+    } else {
+        nearest_row_sse(d, s, x, step, n);
+    }
+}
+
+// bilinear sample: pixels `x` and `x` + 1 weighted 256 - `weight` and `weight`
+struct Sample {
+    u32 x;
+    u32 weight;
+};
+
+// returns sample at 16.16 fixed point position `p` in `size` pixels
+// note: `size` is at least 2
+auto inline sample_at(i64 const p, u32 const size) -> Sample {
+    if (p <= 0) {
+        return {0, 0};
+    }
+    if (p >= i64(size - 1) << 16) {
+        // last pixel, fully weighted so that no pixel past it is read
+        return {size - 2, 256};
+    }
+    return {u32(p >> 16), u32(p >> 8) & 0xff};
+}
+
+// returns the 2 pixels at `p` widened to 16 bits
+auto inline widen_pair(u32 const* const p) -> u16x8 {
+    auto const pair = *ptr<memory::u64u const>(p);
+    return __builtin_convertvector(u8x8(pair), u16x8);
+}
+
+// blends `r0` and `r1` weighted 256 - `wy` and `wy` into `n` pixels at `d`,
+// sampling at `x` growing by `step` in rows of `size` pixels
+// note: exact in 16 bits since 255 * 256 = 65280; each of the two passes
+//       rounds down
+auto inline bilinear_row_sse(u32* const d, u32 const* const r0,
+                             u32 const* const r1, u32 const wy, i64 x,
+                             i64 const step, u32 const size, u32 const n)
+    -> void {
+    auto const wy0 = u16(256 - wy);
+    auto const wy1 = u16(wy);
+    for (auto i = 0u; i < n; ++i, x += step) {
+        auto const s = sample_at(x, size);
+        auto const w0 = u16(256 - s.weight);
+        auto const w1 = u16(s.weight);
+        auto const wx = u16x8{w0, w0, w0, w0, w1, w1, w1, w1};
+
+        // pixels x and x + 1 weighted, then the two summed
+        auto const top = widen_pair(r0 + s.x) * wx;
+        auto const bottom = widen_pair(r1 + s.x) * wx;
+        auto const t =
+            (top + __builtin_shufflevector(top, top, 4, 5, 6, 7, 0, 1, 2, 3)) >>
+            8;
+        auto const b = (bottom + __builtin_shufflevector(bottom, bottom, 4, 5,
+                                                         6, 7, 0, 1, 2, 3)) >>
+                       8;
+        auto const pixel = __builtin_convertvector((t * wy0 + b * wy1) >> 8,
+                                                   u8x8);
+        // channels of the pixel in lanes 0 to 3
+        d[i] = u32(u64(pixel));
+    }
+}
+
+// returns the 2 pixels at `a` and the 2 at `b` widened to 16 bits
+[[gnu::target("avx2")]] inline auto widen_pairs(u32 const* const a,
+                                                u32 const* const b) -> u16x16 {
+    auto const pairs = u64x2{*ptr<memory::u64u const>(a),
+                             *ptr<memory::u64u const>(b)};
+    return __builtin_convertvector(u8x16(pairs), u16x16);
+}
+
+// as `bilinear_row_sse`, 2 pixels at a time
+[[gnu::target("avx2")]] inline auto
+bilinear_row_avx2(u32* const d, u32 const* const r0, u32 const* const r1,
+                  u32 const wy, i64 x, i64 const step, u32 const size,
+                  u32 const n) -> void {
+    auto const wy0 = u16(256 - wy);
+    auto const wy1 = u16(wy);
+    auto i = 0u;
+    for (; i + 2 <= n; i += 2, x += 2 * step) {
+        auto const s = sample_at(x, size);
+        auto const u = sample_at(x + step, size);
+        auto const w0 = u16(256 - s.weight);
+        auto const w1 = u16(s.weight);
+        auto const v0 = u16(256 - u.weight);
+        auto const v1 = u16(u.weight);
+        auto const wx = u16x16{w0, w0, w0, w0, w1, w1, w1, w1,
+                               v0, v0, v0, v0, v1, v1, v1, v1};
+
+        auto const top = widen_pairs(r0 + s.x, r0 + u.x) * wx;
+        auto const bottom = widen_pairs(r1 + s.x, r1 + u.x) * wx;
+        auto const t = (top + __builtin_shufflevector(top, top, 4, 5, 6, 7, 0,
+                                                      1, 2, 3, 12, 13, 14, 15,
+                                                      8, 9, 10, 11)) >>
+                       8;
+        auto const b =
+            (bottom + __builtin_shufflevector(bottom, bottom, 4, 5, 6, 7, 0, 1,
+                                              2, 3, 12, 13, 14, 15, 8, 9, 10,
+                                              11)) >>
+            8;
+        auto const pixels = u32x4(
+            __builtin_convertvector((t * wy0 + b * wy1) >> 8, u8x16));
+        d[i] = pixels[0];
+        d[i + 1] = pixels[2];
+    }
+    if (i < n) {
+        bilinear_row_sse(d + i, r0, r1, wy, x, step, size, n - i);
+    }
+}
+
+// fills part of `rect` inside `target` with `color`
+// note: large fills bypass the caches, for example on the frame buffer
+auto inline fill_rect(FrameBuffer const& target, Rect rect, u32 const color)
+    -> void {
+    rect = intersect(rect, {0, 0, target.width, target.height});
+    if (rect.empty()) {
+        return;
+    }
+    auto const streaming = rect.area() > STREAMING_PIXELS;
+    for (auto y = rect.top; y < rect.bottom; ++y) {
+        fill_row(target.pixels + u64(y) * target.stride + rect.left, color,
+                 rect.right - rect.left, streaming);
+    }
+    if (streaming) {
+        // note: non-temporal stores are weakly ordered
+        __builtin_ia32_sfence();
+    }
+}
+
+// blends `color` with alpha in its top byte over part of `rect` inside
+// `target`
+auto inline blend_rect(FrameBuffer const& target, Rect rect, u32 const color)
+    -> void {
+    rect = intersect(rect, {0, 0, target.width, target.height});
+    if (rect.empty()) {
+        return;
+    }
+    for (auto y = rect.top; y < rect.bottom; ++y) {
+        blend_row(target.pixels + u64(y) * target.stride + rect.left, nullptr,
+                  color, rect.right - rect.left);
+    }
+}
+
+// part of a blit inside target and source
+struct Clipped {
+    Rect target;
+    u32 source_left;
+    u32 source_top;
+};
+
+// returns `source_rect` of `source` placed at `x`, `y` of `target`, clipped
+// to both
+auto inline clip(FrameBuffer const& target, i32 const x, i32 const y,
+                 FrameBuffer const& source, Rect source_rect) -> Clipped {
+    source_rect = intersect(source_rect, {0, 0, source.width, source.height});
+    if (source_rect.empty()) {
+        return {};
+    }
+    auto const left = i64(x) < 0 ? u32(-i64(x)) : 0u;
+    auto const top = i64(y) < 0 ? u32(-i64(y)) : 0u;
+    auto const width = i64(source_rect.right - source_rect.left);
+    auto const height = i64(source_rect.bottom - source_rect.top);
+    if (left >= width || top >= height) {
+        return {};
+    }
+    auto const right = i64(x) + width < i64(target.width)
+                           ? i64(x) + width
+                           : i64(target.width);
+    auto const bottom = i64(y) + height < i64(target.height)
+                            ? i64(y) + height
+                            : i64(target.height);
+    return {{u32(i64(x) + left), u32(i64(y) + top),
+             u32(right > 0 ? right : 0), u32(bottom > 0 ? bottom : 0)},
+            source_rect.left + left,
+            source_rect.top + top};
+}
+
+// copies `source_rect` of `source` to `x`, `y` of `target`, clipped to both
+// note: `source` and `target` must not overlap
+auto inline blit(FrameBuffer const& target, i32 const x, i32 const y,
+                 FrameBuffer const& source, Rect const source_rect) -> void {
+    auto const c = clip(target, x, y, source, source_rect);
+    if (c.target.empty()) {
+        return;
+    }
+    auto const bytes = u64(c.target.right - c.target.left) * sizeof(u32);
+    for (auto row = c.target.top; row < c.target.bottom; ++row) {
+        memory::copy(
+            target.pixels + u64(row) * target.stride + c.target.left,
+            source.pixels +
+                u64(c.source_top + row - c.target.top) * source.stride +
+                c.source_left,
+            bytes);
+    }
+}
+
+// blends `source_rect` of `source` with alpha in the top byte of each pixel
+// over `x`, `y` of `target`, clipped to both
+auto inline blit_blend(FrameBuffer const& target, i32 const x, i32 const y,
+                       FrameBuffer const& source, Rect const source_rect)
+    -> void {
+    auto const c = clip(target, x, y, source, source_rect);
+    if (c.target.empty()) {
+        return;
+    }
+    for (auto row = c.target.top; row < c.target.bottom; ++row) {
+        blend_row(target.pixels + u64(row) * target.stride + c.target.left,
+                  source.pixels +
+                      u64(c.source_top + row - c.target.top) * source.stride +
+                      c.source_left,
+                  0, c.target.right - c.target.left);
+    }
+}
+
+// scales `source_rect` of `source` to `target_rect` of `target`, clipped to
+// both, taking the nearest pixel
+auto inline scale_nearest(FrameBuffer const& target, Rect const target_rect,
+                          FrameBuffer const& source, Rect source_rect)
+    -> void {
+    source_rect = intersect(source_rect, {0, 0, source.width, source.height});
+    auto const rect =
+        intersect(target_rect, {0, 0, target.width, target.height});
+    if (source_rect.empty() || rect.empty()) {
+        return;
+    }
+
+    // 16.16 fixed point source pixels per target pixel
+    auto const step_x = u32((u64(source_rect.right - source_rect.left) << 16) /
+                            (target_rect.right - target_rect.left));
+    auto const step_y = u32((u64(source_rect.bottom - source_rect.top) << 16) /
+                            (target_rect.bottom - target_rect.top));
+    // centers of the first target pixels
+    auto const x = step_x / 2 + (rect.left - target_rect.left) * step_x;
+    auto sy = step_y / 2 + (rect.top - target_rect.top) * step_y;
+
+    for (auto y = rect.top; y < rect.bottom; ++y, sy += step_y) {
+        nearest_row(target.pixels + u64(y) * target.stride + rect.left,
+                    source.pixels +
+                        u64(source_rect.top + (sy >> 16)) * source.stride +
+                        source_rect.left,
+                    x, step_x, rect.right - rect.left);
+    }
+}
+
+// scales `source_rect` of `source` to `target_rect` of `target`, clipped to
+// both, interpolating between the 4 nearest pixels
+// note: sources less than 2 pixels wide or high are scaled by
+//       `scale_nearest`
+auto inline scale_bilinear(FrameBuffer const& target, Rect const target_rect,
+                           FrameBuffer const& source, Rect source_rect)
+    -> void {
+    source_rect = intersect(source_rect, {0, 0, source.width, source.height});
+    auto const rect =
+        intersect(target_rect, {0, 0, target.width, target.height});
+    if (source_rect.empty() || rect.empty()) {
+        return;
+    }
+    auto const width = source_rect.right - source_rect.left;
+    auto const height = source_rect.bottom - source_rect.top;
+    if (width < 2 || height < 2) {
+        scale_nearest(target, target_rect, source, source_rect);
+        return;
+    }
+
+    auto const step_x =
+        i64((u64(width) << 16) / (target_rect.right - target_rect.left));
+    auto const step_y =
+        i64((u64(height) << 16) / (target_rect.bottom - target_rect.top));
+    // centers of the first target pixels between source pixel centers
+    auto const x =
+        step_x / 2 - 0x8000 + i64(rect.left - target_rect.left) * step_x;
+    auto sy = step_y / 2 - 0x8000 + i64(rect.top - target_rect.top) * step_y;
+
+    auto const avx2 = cpu::features.avx2;
+    for (auto y = rect.top; y < rect.bottom; ++y, sy += step_y) {
+        auto const s = sample_at(sy, height);
+        auto const* const r0 = source.pixels +
+                               u64(source_rect.top + s.x) * source.stride +
+                               source_rect.left;
+        auto const* const r1 = r0 + source.stride;
+        auto* const d = target.pixels + u64(y) * target.stride + rect.left;
+        if (avx2) {
+            bilinear_row_avx2(d, r0, r1, s.weight, x, step_x, width,
+                              rect.right - rect.left);
+        } else {
+            bilinear_row_sse(d, r0, r1, s.weight, x, step_x, width,
+                             rect.right - rect.left);
+        }
+    }
+}
+
+// copies `n` pixels with non-temporal stores of 16 bytes
+auto inline stream_sse(u32* d, u32 const* s, u32 n) -> void {
+    // single pixels up to the alignment of the stores
+    for (; n && (uptr(d) & 15); ++d, ++s, --n) {
+        __builtin_ia32_movnti(ptr<i32>(d), i32(*s));
+    }
+    for (; n >= 4; d += 4, s += 4, n -= 4) {
+        __builtin_ia32_movntdq(ptr<memory::v16>(d),
+                               *ptr<memory::v16u const>(s));
+    }
+    for (; n; ++d, ++s, --n) {
+        __builtin_ia32_movnti(ptr<i32>(d), i32(*s));
+    }
+}
+
+// copies `n` pixels with non-temporal stores of 32 bytes
+[[gnu::target("avx")]] inline auto stream_avx(u32* d, u32 const* s, u32 n)
+    -> void {
+    for (; n && (uptr(d) & 31); ++d, ++s, --n) {
+        __builtin_ia32_movnti(ptr<i32>(d), i32(*s));
+    }
+    for (; n >= 8; d += 8, s += 8, n -= 8) {
+        __builtin_ia32_movntdq256(ptr<memory::v32>(d),
+                                  *ptr<memory::v32u const>(s));
+    }
+    for (; n; ++d, ++s, --n) {
+        __builtin_ia32_movnti(ptr<i32>(d), i32(*s));
+    }
+}
+
+class BackBuffer final {
+    u32* pixels_;
+    u32 width_;
+    u32 height_;
+    // pixels per row, rows start on a cache line
+    u32 stride_;
+
+    Rect dirty_[MAX_DIRTY];
+    u32 dirty_count_;
+
+  public:
+    // returns pixels per row of a buffer `width` pixels wide
+    auto static constexpr stride_of(u32 const width) -> u32 {
+        // 16 pixels per cache line
+        return (width + 15) & ~15u;
+    }
+
+    // returns bytes of a buffer of `width` by `height` pixels
+    auto static constexpr size_of(u32 const width, u32 const height) -> u64 {
+        return u64(stride_of(width)) * height * sizeof(u32);
+    }
+
+    // uses `size_of(width, height)` bytes at `memory`, aligned to a cache
+    // line, as a buffer of `width` by `height` pixels
+    // note: the content is undefined and nothing is dirty
+    auto init(void* const memory, u32 const width, u32 const height) -> void {
+        pixels_ = ptr<u32>(memory);
+        width_ = width;
+        height_ = height;
+        stride_ = stride_of(width);
+        dirty_count_ = 0;
+    }
+
+    auto pixels() -> u32* { return pixels_; }
+    auto width() const -> u32 { return width_; }
+    auto height() const -> u32 { return height_; }
+    auto stride() const -> u32 { return stride_; }
+
+    // returns first pixel of row `y`
+    auto row(u32 const y) -> u32* { return pixels_ + u64(y) * stride_; }
+
+    auto bounds() const -> Rect { return {0, 0, width_, height_}; }
+
+    // returns the buffer as a target of the drawing functions
+    // note: drawing through it does not mark rectangles dirty
+    auto surface() const -> FrameBuffer {
+        return {pixels_, width_, height_, stride_};
+    }
+
+    // returns number of dirty rectangles
+    auto dirty_count() const -> u32 { return dirty_count_; }
+
+    // returns dirty rectangle `i`
+    auto dirty(u32 const i) const -> Rect { return dirty_[i]; }
+
+    // marks `rect` to be presented
+    // note: merges with dirty rectangles when the bounds of both cover no
+    //       more pixels than both apart, for example neighbours
+    auto mark(Rect rect) -> void {
+        rect = intersect(rect, bounds());
+        if (rect.empty()) {
+            return;
+        }
+
+        for (auto i = 0u; i < dirty_count_;) {
+            auto const merged = graphics::bounds(rect, dirty_[i]);
+            if (merged.area() <= rect.area() + dirty_[i].area()) {
+                // note: the merged rectangle may now merge with earlier ones
+                rect = merged;
+                dirty_[i] = dirty_[--dirty_count_];
+                i = 0;
+            } else {
+                ++i;
+            }
+        }
+
+        if (dirty_count_ < MAX_DIRTY) {
+            dirty_[dirty_count_++] = rect;
+            return;
+        }
+
+        // full: grow the rectangle that grows the least
+        auto best = 0u;
+        auto best_growth = ~0ull;
+        for (auto i = 0u; i < MAX_DIRTY; ++i) {
+            auto const growth =
+                graphics::bounds(rect, dirty_[i]).area() - dirty_[i].area();
+            if (growth < best_growth) {
+                best = i;
+                best_growth = growth;
+            }
+        }
+        dirty_[best] = graphics::bounds(rect, dirty_[best]);
+    }
+
+    // marks the whole buffer to be presented
+    auto mark_all() -> void {
+        dirty_[0] = bounds();
+        dirty_count_ = 1;
+    }
+
+    // fills `rect` with `color` and marks it
+    auto fill(Rect const rect, u32 const color) -> void {
+        fill_rect(surface(), rect, color);
+        mark(rect);
+    }
+
+    // copies the dirty rectangles to `target` and clears them
+    // note: `target` is only written, with non-temporal stores
+    // returns:
+    //   number of pixels copied
+    auto present(FrameBuffer const& target) -> u64 {
+        auto const clip = Rect{0, 0, target.width, target.height};
+        auto const avx = cpu::features.avx;
+
+        auto copied = 0ull;
+        for (auto i = 0u; i < dirty_count_; ++i) {
+            auto const rect = intersect(dirty_[i], clip);
+            if (rect.empty()) {
+                continue;
+            }
+            auto const width = rect.right - rect.left;
+            for (auto y = rect.top; y < rect.bottom; ++y) {
+                auto* const d =
+                    target.pixels + u64(y) * target.stride + rect.left;
+                auto const* const s = row(y) + rect.left;
+                if (avx) {
+                    stream_avx(d, s, width);
+                } else {
+                    stream_sse(d, s, width);
+                }
+            }
+            copied += rect.area();
+        }
+        // note: non-temporal stores are weakly ordered
+        __builtin_ia32_sfence();
+
+        dirty_count_ = 0;
+        return copied;
+    }
+};
+
+BackBuffer inline back_buffer;
+
+} // namespace kernel::graphics
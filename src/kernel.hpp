@@ -1,5 +1,7 @@
 #pragma once
 
+#include "format.hpp"
+#include "memory.hpp"
 #include "types.hpp"
 
 namespace kernel {
@@ -40,7 +42,9 @@ struct Core {
     u8 apic_id;
 };
 
-Core inline cores[256];
+auto constexpr MAX_CORES = 256u;
+
+Core inline cores[MAX_CORES];
 u8 inline core_count;
 
 struct Heap {
@@ -82,41 +86,36 @@ auto inline print_hex_byte(u8 const val) -> void {
 }
 
 auto inline print_hex(u64 const val) -> void {
-    print_hex_byte(u8(val >> 56));
-    print_hex_byte(u8(val >> 48));
-    outb(0x3f8, '_');
-    print_hex_byte(u8(val >> 40));
-    print_hex_byte(u8(val >> 32));
-    outb(0x3f8, '_');
-    print_hex_byte(u8(val >> 24));
-    print_hex_byte(u8(val >> 16));
-    outb(0x3f8, '_');
-    print_hex_byte(u8(val >> 8));
-    print_hex_byte(u8(val));
-}
-
-auto inline print_dec(u64 val) -> void {
-    // case for zero
-    if (val == 0) {
-        outb(0x3f8, '0');
-        return;
+    char digits[format::HEX_SIZE];
+    format::hex(digits, val);
+    for (auto i = 0u; i < format::HEX_SIZE; ++i) {
+        // groups of 2 bytes
+        if (i && i % 4 == 0) {
+            outb(0x3f8, '_');
+        }
+        outb(0x3f8, u8(digits[i]));
     }
+}
 
-    // u64 max is 20 digits
-    u8 buffer[20];
-    auto i = 0u;
-
-    // extract digits in reverse order
-    while (val > 0) {
-        buffer[i] = u8('0' + (val % 10));
-        val /= 10;
-        ++i;
+auto inline print_dec(u64 const val) -> void {
+    char digits[format::DEC_SIZE];
+    auto const n = format::dec(digits, val);
+    for (auto i = 0u; i < n; ++i) {
+        outb(0x3f8, u8(digits[i]));
     }
+}
 
-    // print the buffer backwards
-    while (i > 0) {
-        --i;
-        outb(0x3f8, buffer[i]);
+// prints `format` with `args`, see `format.hpp`
+// note: output beyond 256 characters is dropped
+template <typename T, typename... Args>
+auto inline print(
+    typename type_identity<format::Format<T, Args...>>::type const& format,
+    T const arg, Args const... args) -> void {
+    char text[256];
+    auto const n = format::to<T, Args...>(text, sizeof(text), format, arg,
+                                          args...);
+    for (auto i = 0u; i < n; ++i) {
+        outb(0x3f8, u8(text[i]));
     }
 }
 
@@ -132,13 +131,26 @@ auto inline interrupts_enable() -> void { asm volatile("sti"); }
 auto inline interrupts_disable() -> void { asm volatile("cli"); }
 auto inline halt() -> void { asm volatile("hlt"); }
 
+// time stamp counter, constant rate on modern x86_64 processors
+auto inline rdtsc() -> u64 { return __builtin_ia32_rdtsc(); }
+
+// index in `cores` of the calling core
+// note: implemented by the kernel in one translation unit; host tests define
+//       it inline in `test.hpp`
+auto index() -> u32;
+
 } // namespace kernel::core
 
 namespace kernel {
 
 [[noreturn]] auto inline panic(u32 const color) -> void {
-    for (auto i = 0u; i < frame_buffer.stride * frame_buffer.height; ++i) {
-        frame_buffer.pixels[i] = color;
+    // non-temporal stores suit the write-combined frame buffer
+    // note: as `graphics::fill_rect`, which includes this file
+    auto const bytes =
+        u64(frame_buffer.stride) * frame_buffer.height * sizeof(u32);
+    if (bytes >= 64) {
+        memory::fill_streaming(ptr<u8>(frame_buffer.pixels),
+                               u64(color) * 0x0000000100000001ull, bytes);
     }
 
     // infinite loop so the hardware doesn't reboot
@@ -175,17 +187,33 @@ extern "C" i32 _fltused;
 // built-in replacements
 //
 
+// note: size-tiered, see `memory.hpp`
 extern "C" auto inline memset(void* s, i32 const c, u64 n) -> void* {
-    void* original_s = s;
-    asm volatile("rep stosb" : "+D"(s), "+c"(n) : "a"(u8(c)) : "memory");
-    return original_s;
+    return kernel::memory::fill(s, u8(c), n);
 }
 
 extern "C" auto inline memcpy(void* dest, void const* src, u64 count) -> void* {
+    return kernel::memory::copy(dest, src, count);
+}
+
+// note: `usize` and `int` match the built-in declarations
+extern "C" auto inline memmove(void* dest, void const* src, usize count)
+    -> void* {
+    return kernel::memory::move(dest, src, count);
+}
+
+extern "C" auto inline memcmp(void const* lhs, void const* rhs, usize count)
+    -> int {
+    return kernel::memory::compare(lhs, rhs, count);
+}
+
+extern "C" auto inline memchr(void const* s, int const c, usize n) -> void* {
+    return kernel::memory::find(s, u8(c), n);
+}
 
-    void* original_dest = dest;
-    asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(count) : : "memory");
-    return original_dest;
+// note: streaming, see `memory::zero`
+extern "C" auto inline bzero(void* s, usize n) -> void {
+    kernel::memory::zero(s, n);
 }
 
 // // placement new
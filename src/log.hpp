@@ -0,0 +1,328 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "format.hpp"
+#include "kernel.hpp"
+#include "types.hpp"
+
+#if __STDC_HOSTED__
+#include <unistd.h>
+#endif
+
+//
+// per-core log rings drained to a sink
+//
+// a core formats a record into a `Line` on its stack and appends it to its
+// own ring without blocking; one core at a time drains the rings and feeds
+// whole records to the sink so records from different cores never interleave
+//
+// `binary` writes a compact record of a format string id and the raw
+// arguments instead of text; the host tool `logtool` decodes them using a
+// table of the format strings extracted from the sources
+//
+// the kernel sink writes to the serial port, the hosted stand-in writes to
+// file descriptor `sink_fd`
+//
+// usage:
+//   log::print("pages: ", count, " at ", log::Hex{address}, "\n");
+//   log::text("pages: {} at {x}\n", count, address);
+//   log::binary("pages: {} at {x}\n", count, address);
+//   idle consumer or a dedicated job:
+//     log::drain();
+//
+// thread safety:
+//  * print(), text(), binary(), write(): any core; rings are indexed by
+//    `kernel::core::index`
+//  * drain(): any core, one drains at a time and the others return
+//  * set_sink(): before logging
+//  * dropped(): any core
+//
+// constraints:
+//  * record size: at most `LINE_SIZE` bytes, longer records are truncated
+//  * records are dropped while the core's ring is full
+//  * must not be used from interrupt handlers (per-core state)
+//
+namespace kernel::log {
+
+// bytes in a core's ring
+auto constexpr RING_SIZE = 4096u;
+
+// bytes of a record
+auto constexpr LINE_SIZE = 128u;
+
+static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "power of 2");
+
+// record being formatted
+struct Line {
+    u8 data[LINE_SIZE];
+    u32 size = 0;
+
+    auto text(char const* s) -> Line& {
+        while (*s && size < LINE_SIZE) {
+            data[size++] = u8(*s++);
+        }
+        return *this;
+    }
+
+    auto chr(char const c) -> Line& { return byte(u8(c)); }
+
+    auto byte(u8 const b) -> Line& {
+        if (size < LINE_SIZE) {
+            data[size++] = b;
+        }
+        return *this;
+    }
+
+    // 7 bits per byte, low first, high bit set if more follow
+    auto varint(u64 value) -> Line& {
+        while (value >= 0x80) {
+            byte(u8(value | 0x80));
+            value >>= 7;
+        }
+        return byte(u8(value));
+    }
+
+    auto dec(u64 const value) -> Line& {
+        auto buffer = this->buffer();
+        buffer.dec(value);
+        size = buffer.size;
+        return *this;
+    }
+
+    auto hex(u64 const value) -> Line& {
+        auto buffer = this->buffer();
+        buffer.hex(value);
+        size = buffer.size;
+        return *this;
+    }
+
+    // returns the free bytes of the record for `format`
+    // note: the record's size is set from `Buffer::size` when done
+    auto buffer() -> format::Buffer {
+        return format::Buffer{ptr<char>(data), LINE_SIZE, size};
+    }
+};
+
+// format string of `text` and `binary`, see `format.hpp`
+template <typename... Args> using Format = format::Format<Args...>;
+
+// argument of `print` written in hex
+struct Hex {
+    u64 value;
+};
+
+using Sink = auto (*)(u8 const* data, u32 size) -> void;
+
+#if __STDC_HOSTED__
+
+// file descriptor of the hosted sink
+i32 inline sink_fd = 1;
+
+auto inline default_sink(u8 const* const data, u32 const size) -> void {
+    auto written = 0u;
+    while (written < size) {
+        auto const n = ::write(sink_fd, data + written, size - written);
+        if (n <= 0) {
+            return;
+        }
+        written += u32(n);
+    }
+}
+
+#else
+
+auto inline default_sink(u8 const* const data, u32 const size) -> void {
+    for (auto i = 0u; i < size; ++i) {
+        outb(0x3f8, data[i]);
+    }
+}
+
+#endif
+
+// records of a core
+// note: a record is published whole by advancing `head` past it
+struct alignas(core::CACHE_LINE_SIZE) Ring {
+    u8 data[RING_SIZE];
+
+    // written by owning core, read by drainer
+    alignas(core::CACHE_LINE_SIZE) u32 head;
+    // records dropped while full
+    u32 dropped;
+
+    // written by drainer, read by owning core
+    alignas(core::CACHE_LINE_SIZE) u32 tail;
+};
+
+Ring inline rings[MAX_CORES];
+
+Sink inline sink = default_sink;
+
+// held by the draining core
+atomic::Spinlock inline draining;
+
+// called before logging
+auto inline set_sink(Sink const s) -> void { sink = s; }
+
+// appends `line` to the calling core's ring
+// returns:
+//   false if ring was full and the record dropped
+auto inline write(Line const& line) -> bool {
+    auto& ring = rings[core::index()];
+    auto const head = ring.head;
+    auto const need = line.size;
+
+    // (4) paired with release (3)
+    auto const tail = atomic::load(&ring.tail, atomic::ACQUIRE);
+    if (RING_SIZE - (head - tail) < need) {
+        atomic::store(&ring.dropped, ring.dropped + 1, atomic::RELAXED);
+        return false;
+    }
+
+    // copy in up to two parts around the end of the ring
+    auto const at = head & (RING_SIZE - 1);
+    auto const first = RING_SIZE - at < need ? RING_SIZE - at : need;
+    memory::copy(ring.data + at, line.data, first);
+    memory::copy(ring.data, line.data + first, need - first);
+
+    // (1) paired with acquire (2)
+    atomic::store(&ring.head, head + need, atomic::RELEASE);
+    return true;
+}
+
+auto inline append(Line& line, char const* const s) -> void { line.text(s); }
+auto inline append(Line& line, char const c) -> void { line.chr(c); }
+auto inline append(Line& line, Hex const h) -> void { line.hex(h.value); }
+
+// integers in decimal
+template <typename T> auto inline append(Line& line, T const value) -> void {
+    if constexpr (T(-1) < T(0)) {
+        if (value < 0) {
+            line.chr('-');
+            line.dec(u64(0) - u64(value));
+            return;
+        }
+    }
+    line.dec(u64(value));
+}
+
+// formats `args` into a record and appends it to the calling core's ring
+// returns:
+//   false if ring was full and the record dropped
+template <typename... Args> auto inline print(Args const&... args) -> bool {
+    Line line;
+    (append(line, args), ...);
+    return write(line);
+}
+
+// formats `format` with `args` into a record and appends it to the calling
+// core's ring
+// note: takes the format strings of `binary`
+// returns:
+//   false if ring was full and the record dropped
+template <typename... Args>
+auto inline text(typename type_identity<Format<Args...>>::type const& format,
+                 Args const... args) -> bool {
+    Line line;
+    auto buffer = line.buffer();
+    format::append<Args...>(buffer, format, args...);
+    line.size = buffer.size;
+    return write(line);
+}
+
+//
+// binary records
+//
+// layout: `BINARY`, format id (4 bytes little endian), size of the arguments
+// (1 byte), the arguments as varints with signed ones zigzag encoded
+//
+// placeholders: those of `format.hpp` except `{s}`
+//
+
+// first byte of a binary record, never found in text
+auto constexpr BINARY = u8(0xfe);
+
+// most arguments of a binary record so that it fits a `Line`
+auto constexpr BINARY_ARGS = 12u;
+
+// appends argument of a binary record
+template <typename T> auto inline append_binary(Line& line, T const value)
+    -> void {
+    if constexpr (T(-1) < T(0)) {
+        // zigzag: small magnitudes stay small
+        auto const v = i64(value);
+        line.varint((u64(v) << 1) ^ u64(v >> 63));
+    } else {
+        line.varint(u64(value));
+    }
+}
+
+// appends a binary record of `format` and `args` to the calling core's ring
+// returns:
+//   false if ring was full and the record dropped
+template <typename... Args>
+auto inline binary(typename type_identity<Format<Args...>>::type const& format,
+                   Args const... args) -> bool {
+    static_assert(sizeof...(Args) <= BINARY_ARGS, "too many arguments");
+    static_assert(((format::kind_of<Args>() != format::Kind::STRING) && ...),
+                  "strings are not supported in binary records");
+
+    Line line;
+    line.byte(BINARY);
+    line.byte(u8(format.id));
+    line.byte(u8(format.id >> 8));
+    line.byte(u8(format.id >> 16));
+    line.byte(u8(format.id >> 24));
+    line.byte(0);
+    auto const start = line.size;
+    (append_binary(line, args), ...);
+    line.data[start - 1] = u8(line.size - start);
+    return write(line);
+}
+
+// feeds the records of all rings to the sink
+// returns:
+//   bytes drained, 0 if another core is draining
+auto inline drain() -> u32 {
+    if (!draining.try_lock()) {
+        return 0;
+    }
+
+    auto total = 0u;
+    for (auto i = 0u; i < MAX_CORES; ++i) {
+        auto& ring = rings[i];
+        // (2) paired with release (1)
+        auto const head = atomic::load(&ring.head, atomic::ACQUIRE);
+        auto const tail = ring.tail;
+        if (tail == head) {
+            continue;
+        }
+
+        // whole records in up to two parts around the end of the ring
+        auto const size = head - tail;
+        auto const at = tail & (RING_SIZE - 1);
+        auto const first = RING_SIZE - at < size ? RING_SIZE - at : size;
+        sink(ring.data + at, first);
+        if (first < size) {
+            sink(ring.data, size - first);
+        }
+
+        // (3) paired with acquire (4)
+        atomic::store(&ring.tail, head, atomic::RELEASE);
+        total += size;
+    }
+
+    draining.unlock();
+    return total;
+}
+
+// returns number of records dropped by all cores
+// note: intended to be used in status displays etc
+auto inline dropped() -> u64 {
+    auto total = 0ull;
+    for (auto const& ring : rings) {
+        total += atomic::load(&ring.dropped, atomic::RELAXED);
+    }
+    return total;
+}
+
+} // namespace kernel::log
@@ -0,0 +1,55 @@
+// decoder of binary log records
+//
+// build:
+//   clang++ -std=c++26 -O2 -o logtool src/logtool.cpp
+//
+// usage:
+//   generate the table from the sources at build time:
+//     ./logtool table src/*.hpp src/*.cpp > formats.tsv
+//   decode a captured log, for example the serial output:
+//     ./logtool decode formats.tsv < serial.log
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "logtool.hpp"
+
+// note: the tool is single-threaded
+auto kernel::core::index() -> u32 { return 0; }
+
+int main(int argc, char** argv) {
+    auto const command = argc > 1 ? std::string(argv[1]) : std::string();
+
+    if (command == "table") {
+        logtool::Table table;
+        auto ok = true;
+        for (auto i = 2; i < argc; ++i) {
+            std::ifstream file(argv[i]);
+            std::stringstream source;
+            source << file.rdbuf();
+            ok = logtool::add_source(table, source.str()) && ok;
+        }
+        logtool::write_table(table, std::cout);
+        if (!ok) {
+            std::cerr << "formats with the same id\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (command == "decode" && argc > 2) {
+        std::ifstream file(argv[2]);
+        auto const table = logtool::read_table(file);
+        auto const stats = logtool::decode(table, std::cin, std::cout);
+        std::cerr << "records " << stats.records << ", unknown "
+                  << stats.unknown << ", malformed " << stats.malformed
+                  << "\n";
+        return stats.unknown || stats.malformed ? 1 : 0;
+    }
+
+    std::cerr << "usage: logtool table SOURCES... > TABLE\n"
+                 "       logtool decode TABLE < LOG\n";
+    return 2;
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "log.hpp"
+
+//
+// host decoder of binary log records
+//
+// the table maps format ids to format strings; it is generated from the
+// sources at build time and used to turn the binary records of a log stream
+// back into text while text records pass through
+//
+namespace logtool {
+
+using Table = std::map<u32, std::string>;
+
+// returns the format strings of `binary(` calls in `source`
+// note: the format must be a single string literal following the call
+inline auto extract(std::string const& source) -> std::vector<std::string> {
+    std::vector<std::string> formats;
+    auto const call = std::string("binary(");
+    for (auto at = source.find(call); at != std::string::npos;
+         at = source.find(call, at + 1)) {
+        auto i = at + call.size();
+        while (i < source.size() && std::isspace(u8(source[i]))) {
+            ++i;
+        }
+        if (i == source.size() || source[i] != '"') {
+            continue;
+        }
+
+        std::string format;
+        for (++i; i < source.size() && source[i] != '"'; ++i) {
+            if (source[i] != '\\' || i + 1 == source.size()) {
+                format += source[i];
+                continue;
+            }
+            switch (source[++i]) {
+            case 'n':
+                format += '\n';
+                break;
+            case 't':
+                format += '\t';
+                break;
+            default:
+                format += source[i];
+                break;
+            }
+        }
+        formats.push_back(format);
+    }
+    return formats;
+}
+
+// adds the formats of `source` to `table`
+// returns:
+//   false if two formats have the same id
+inline auto add_source(Table& table, std::string const& source) -> bool {
+    auto ok = true;
+    for (auto const& format : extract(source)) {
+        auto const id = kernel::format::id(format.c_str());
+        auto const [it, added] = table.emplace(id, format);
+        ok = ok && (added || it->second == format);
+    }
+    return ok;
+}
+
+// writes `table` as lines of id in hex and escaped format
+inline auto write_table(Table const& table, std::ostream& out) -> void {
+    for (auto const& [id, format] : table) {
+        char hex[9];
+        std::snprintf(hex, sizeof(hex), "%08X", id);
+        out << hex << '\t';
+        for (auto c : format) {
+            switch (c) {
+            case '\n':
+                out << "\\n";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            default:
+                out << c;
+                break;
+            }
+        }
+        out << '\n';
+    }
+}
+
+// returns the table written by `write_table`
+inline auto read_table(std::istream& in) -> Table {
+    Table table;
+    std::string line;
+    while (std::getline(in, line)) {
+        auto const tab = line.find('\t');
+        if (tab == std::string::npos) {
+            continue;
+        }
+        auto const id = u32(std::stoul(line.substr(0, tab), nullptr, 16));
+        std::string format;
+        for (auto i = tab + 1; i < line.size(); ++i) {
+            if (line[i] != '\\' || i + 1 == line.size()) {
+                format += line[i];
+                continue;
+            }
+            auto const c = line[++i];
+            format += c == 'n' ? '\n' : c == 't' ? '\t' : c;
+        }
+        table[id] = format;
+    }
+    return table;
+}
+
+struct Stats {
+    u64 records;
+    u64 unknown;
+    u64 malformed;
+};
+
+// returns value of varint at `at` in `payload` advancing `at`
+inline auto read_varint(std::string const& payload, size_t& at) -> u64 {
+    auto value = 0ull;
+    for (auto shift = 0u; at < payload.size() && shift < 64; shift += 7) {
+        auto const b = u8(payload[at++]);
+        value |= u64(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+// renders binary record of `format` with arguments in `payload`
+// returns:
+//   false if `payload` does not match `format`
+inline auto render(std::string const& format, std::string const& payload,
+                   std::ostream& out) -> bool {
+    auto at = size_t(0);
+    for (auto i = 0u; i < format.size(); ++i) {
+        if (format[i] != '{' || i + 1 == format.size()) {
+            out << format[i];
+            continue;
+        }
+        if (at == payload.size()) {
+            return false;
+        }
+        auto const value = read_varint(payload, at);
+        char text[24];
+        switch (format[i + 1]) {
+        case '}':
+            std::snprintf(text, sizeof(text), "%llu",
+                          static_cast<unsigned long long>(value));
+            i += 1;
+            break;
+        case 'i':
+            std::snprintf(text, sizeof(text), "%lld",
+                          static_cast<long long>((value >> 1) ^ -(value & 1)));
+            i += 2;
+            break;
+        default:
+            std::snprintf(text, sizeof(text), "%016llX",
+                          static_cast<unsigned long long>(value));
+            i += 2;
+            break;
+        }
+        out << text;
+    }
+    return at == payload.size();
+}
+
+// decodes the log stream `in` to `out` using `table`
+inline auto decode(Table const& table, std::istream& in, std::ostream& out)
+    -> Stats {
+    Stats stats{};
+    auto c = 0;
+    while ((c = in.get()) != EOF) {
+        if (u8(c) != kernel::log::BINARY) {
+            out.put(char(c));
+            continue;
+        }
+
+        char header[5];
+        if (!in.read(header, sizeof(header))) {
+            ++stats.malformed;
+            break;
+        }
+        auto const id = u32(u8(header[0])) | u32(u8(header[1])) << 8 |
+                        u32(u8(header[2])) << 16 | u32(u8(header[3])) << 24;
+        std::string payload(u8(header[4]), '\0');
+        if (!in.read(payload.data(), std::streamsize(payload.size()))) {
+            ++stats.malformed;
+            break;
+        }
+
+        ++stats.records;
+        auto const format = table.find(id);
+        if (format == table.end()) {
+            char text[40];
+            std::snprintf(text, sizeof(text), "<unknown format %08X>\n", id);
+            out << text;
+            ++stats.unknown;
+            continue;
+        }
+        if (!render(format->second, payload, out)) {
+            ++stats.malformed;
+        }
+    }
+    return stats;
+}
+
+} // namespace logtool
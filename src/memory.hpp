@@ -0,0 +1,430 @@
+#pragma once
+
+#include "cpu.hpp"
+#include "types.hpp"
+
+//
+// size-tiered memory copy and fill behind `memcpy` and `memset`, and the
+// vectorized `memmove`, `memcmp`, `memchr` and streaming `bzero`
+//
+// tiers by size:
+//  * up to 16 bytes: overlapping scalar loads and stores, no loop
+//  * up to `ERMS_THRESHOLD`, or `FSRM_THRESHOLD` for copies with fsrm: 16
+//    byte (sse2) or 32 byte (avx) vectors with an overlapping tail
+//  * up to `STREAMING_THRESHOLD`: `rep movsb` / `rep stosb` with erms,
+//    otherwise vectors
+//  * larger: non-temporal stores that bypass the caches, for example copies
+//    to the frame buffer
+//
+// note: the vector and rep tiers dispatch on `cpu::features` set by
+//       `cpu::init`
+// note: loops hide the pointer from the optimizer with an empty asm so that
+//       they are not turned back into calls to `memcpy` or `memset`
+//
+namespace kernel::memory {
+
+// below, vectors beat the startup cost of `rep movsb`
+auto constexpr ERMS_THRESHOLD = 2048ull;
+
+// as `ERMS_THRESHOLD` with fast short `rep movsb`
+auto constexpr FSRM_THRESHOLD = 256ull;
+
+// above, the destination is assumed not to be read soon and larger than the
+// caches can hold
+auto constexpr STREAMING_THRESHOLD = 1024ull * 1024;
+
+// unaligned access types
+using u16u = u16 __attribute__((aligned(1), may_alias));
+using u32u = u32 __attribute__((aligned(1), may_alias));
+using u64u = u64 __attribute__((aligned(1), may_alias));
+using v16 = long long __attribute__((vector_size(16)));
+using v16u = long long __attribute__((vector_size(16), aligned(1), may_alias));
+using v32 = long long __attribute__((vector_size(32)));
+using v32u = long long __attribute__((vector_size(32), aligned(1), may_alias));
+using v16b = char __attribute__((vector_size(16)));
+using v16bu = char __attribute__((vector_size(16), aligned(1), may_alias));
+
+// copies up to 16 bytes
+auto inline copy_small(u8* const d, u8 const* const s, u64 const n) -> void {
+    if (n >= 8) {
+        auto const head = *ptr<u64u const>(s);
+        auto const tail = *ptr<u64u const>(s + n - 8);
+        *ptr<u64u>(d) = head;
+        *ptr<u64u>(d + n - 8) = tail;
+    } else if (n >= 4) {
+        auto const head = *ptr<u32u const>(s);
+        auto const tail = *ptr<u32u const>(s + n - 4);
+        *ptr<u32u>(d) = head;
+        *ptr<u32u>(d + n - 4) = tail;
+    } else if (n >= 2) {
+        auto const head = *ptr<u16u const>(s);
+        auto const tail = *ptr<u16u const>(s + n - 2);
+        *ptr<u16u>(d) = head;
+        *ptr<u16u>(d + n - 2) = tail;
+    } else if (n == 1) {
+        *d = *s;
+    }
+}
+
+// copies 17 to `STREAMING_THRESHOLD` bytes with 16 byte vectors
+auto inline copy_sse(u8* d, u8 const* s, u64 const n) -> void {
+    auto const tail = *ptr<v16u const>(s + n - 16);
+    auto* const d_tail = d + n - 16;
+    for (auto* const end = d_tail; d < end; d += 16, s += 16) {
+        asm("" : "+r"(d));
+        *ptr<v16u>(d) = *ptr<v16u const>(s);
+    }
+    *ptr<v16u>(d_tail) = tail;
+}
+
+// copies 33 to `STREAMING_THRESHOLD` bytes with 32 byte vectors
+[[gnu::target("avx")]] inline auto copy_avx(u8* d, u8 const* s, u64 const n)
+    -> void {
+    auto const tail = *ptr<v32u const>(s + n - 32);
+    auto* const d_tail = d + n - 32;
+    for (auto* const end = d_tail; d < end; d += 32, s += 32) {
+        asm("" : "+r"(d));
+        *ptr<v32u>(d) = *ptr<v32u const>(s);
+    }
+    *ptr<v32u>(d_tail) = tail;
+}
+
+// copies more than 16 bytes with the widest vectors available
+// note: loads the tail first and reads ahead of the stores, so safe forward
+auto inline copy_vector(u8* const d, u8 const* const s, u64 const n) -> void {
+    if (n > 32 && cpu::features.avx) {
+        copy_avx(d, s, n);
+    } else {
+        copy_sse(d, s, n);
+    }
+}
+
+// copies `n` bytes with `rep movsb`
+auto inline copy_rep(u8* const d, u8 const* const s, u64 const n) -> void {
+    void* di = d;
+    void const* si = s;
+    auto count = n;
+    asm volatile("rep movsb" : "+D"(di), "+S"(si), "+c"(count) : : "memory");
+}
+
+// returns size above which `rep movsb` is used, never without erms
+auto inline copy_rep_threshold() -> u64 {
+    if (!cpu::features.erms) {
+        return ~0ull;
+    }
+    return cpu::features.fsrm ? FSRM_THRESHOLD : ERMS_THRESHOLD;
+}
+
+// copies at least 64 bytes with non-temporal stores
+auto inline copy_streaming(u8* d, u8 const* s, u64 n) -> void {
+    // unaligned head, then align destination to 16 bytes
+    *ptr<v16u>(d) = *ptr<v16u const>(s);
+    auto const skew = 16 - (uptr(d) & 15);
+    d += skew;
+    s += skew;
+    n -= skew;
+
+    while (n >= 64) {
+        auto const a = *ptr<v16u const>(s);
+        auto const b = *ptr<v16u const>(s + 16);
+        auto const c = *ptr<v16u const>(s + 32);
+        auto const e = *ptr<v16u const>(s + 48);
+        __builtin_ia32_movntdq(ptr<v16>(d), a);
+        __builtin_ia32_movntdq(ptr<v16>(d + 16), b);
+        __builtin_ia32_movntdq(ptr<v16>(d + 32), c);
+        __builtin_ia32_movntdq(ptr<v16>(d + 48), e);
+        d += 64;
+        s += 64;
+        n -= 64;
+    }
+    // note: non-temporal stores are weakly ordered
+    __builtin_ia32_sfence();
+
+    // tail, may overlap bytes already stored
+    if (n > 16) {
+        copy_sse(d, s, n);
+    } else if (n) {
+        *ptr<v16u>(d + n - 16) = *ptr<v16u const>(s + n - 16);
+    }
+}
+
+auto inline copy(void* const dest, void const* const src, u64 const n)
+    -> void* {
+    auto* const d = ptr<u8>(dest);
+    auto const* const s = ptr<u8>(src);
+
+    if (n <= 16) {
+        copy_small(d, s, n);
+    } else if (n > STREAMING_THRESHOLD) {
+        copy_streaming(d, s, n);
+    } else if (n > copy_rep_threshold()) {
+        copy_rep(d, s, n);
+    } else {
+        copy_vector(d, s, n);
+    }
+    return dest;
+}
+
+// fills up to 16 bytes with the bytes of `pattern`
+auto inline fill_small(u8* const d, u64 const pattern, u64 const n) -> void {
+    if (n >= 8) {
+        *ptr<u64u>(d) = pattern;
+        *ptr<u64u>(d + n - 8) = pattern;
+    } else if (n >= 4) {
+        *ptr<u32u>(d) = u32(pattern);
+        *ptr<u32u>(d + n - 4) = u32(pattern);
+    } else if (n >= 2) {
+        *ptr<u16u>(d) = u16(pattern);
+        *ptr<u16u>(d + n - 2) = u16(pattern);
+    } else if (n == 1) {
+        *d = u8(pattern);
+    }
+}
+
+// fills 17 to `STREAMING_THRESHOLD` bytes with 16 byte vectors
+auto inline fill_sse(u8* d, u64 const pattern, u64 const n) -> void {
+    auto const v = v16{} + i64(pattern);
+    auto* const d_tail = d + n - 16;
+    for (auto* const end = d_tail; d < end; d += 16) {
+        asm("" : "+r"(d));
+        *ptr<v16u>(d) = v;
+    }
+    *ptr<v16u>(d_tail) = v;
+}
+
+// fills 33 to `STREAMING_THRESHOLD` bytes with 32 byte vectors
+[[gnu::target("avx")]] inline auto fill_avx(u8* d, u64 const pattern,
+                                            u64 const n) -> void {
+    auto const v = v32{} + i64(pattern);
+    auto* const d_tail = d + n - 32;
+    for (auto* const end = d_tail; d < end; d += 32) {
+        asm("" : "+r"(d));
+        *ptr<v32u>(d) = v;
+    }
+    *ptr<v32u>(d_tail) = v;
+}
+
+// returns size above which `rep stosb` is used, never without erms
+auto inline fill_rep_threshold() -> u64 {
+    return cpu::features.erms ? ERMS_THRESHOLD : ~0ull;
+}
+
+// fills at least 64 bytes with non-temporal stores
+auto inline fill_streaming(u8* d, u64 const pattern, u64 n) -> void {
+    auto const v = v16{} + i64(pattern);
+
+    // unaligned head, then align destination to 16 bytes
+    *ptr<v16u>(d) = v;
+    auto const skew = 16 - (uptr(d) & 15);
+    d += skew;
+    n -= skew;
+
+    while (n >= 64) {
+        __builtin_ia32_movntdq(ptr<v16>(d), v);
+        __builtin_ia32_movntdq(ptr<v16>(d + 16), v);
+        __builtin_ia32_movntdq(ptr<v16>(d + 32), v);
+        __builtin_ia32_movntdq(ptr<v16>(d + 48), v);
+        d += 64;
+        n -= 64;
+    }
+    // note: non-temporal stores are weakly ordered
+    __builtin_ia32_sfence();
+
+    // tail, may overlap bytes already stored
+    if (n > 16) {
+        fill_sse(d, pattern, n);
+    } else if (n) {
+        *ptr<v16u>(d + n - 16) = v;
+    }
+}
+
+auto inline fill(void* const dest, u8 const c, u64 const n) -> void* {
+    auto* const d = ptr<u8>(dest);
+    auto const pattern = u64(c) * 0x0101010101010101ull;
+
+    if (n <= 16) {
+        fill_small(d, pattern, n);
+    } else if (n > STREAMING_THRESHOLD) {
+        fill_streaming(d, pattern, n);
+    } else if (n > fill_rep_threshold()) {
+        void* di = d;
+        auto count = n;
+        asm volatile("rep stosb" : "+D"(di), "+c"(count) : "a"(c) : "memory");
+    } else if (n > 32 && cpu::features.avx) {
+        fill_avx(d, pattern, n);
+    } else {
+        fill_sse(d, pattern, n);
+    }
+    return dest;
+}
+
+// copies `n` bytes from `src` to `dest` where the regions may overlap
+auto inline move(void* const dest, void const* const src, u64 const n)
+    -> void* {
+    auto* d = ptr<u8>(dest);
+    auto const* s = ptr<u8>(src);
+
+    // note: small and vector copies load the tail first and read ahead of
+    //       the stores, so they are safe forward
+    if (n <= 16) {
+        copy_small(d, s, n);
+        return dest;
+    }
+    if (uptr(d) - uptr(s) >= n) {
+        // destination before or after the source
+        // note: streaming stores are not safe with overlap
+        if (n > copy_rep_threshold()) {
+            copy_rep(d, s, n);
+        } else {
+            copy_vector(d, s, n);
+        }
+        return dest;
+    }
+
+    // destination overlaps the end of the source, copy backward loading each
+    // block before storing it
+    auto const head = *ptr<v16u const>(s);
+    auto i = n;
+    for (; i > 64; i -= 64) {
+        asm("" : "+r"(d));
+        auto const a = *ptr<v16u const>(s + i - 16);
+        auto const b = *ptr<v16u const>(s + i - 32);
+        auto const c = *ptr<v16u const>(s + i - 48);
+        auto const e = *ptr<v16u const>(s + i - 64);
+        *ptr<v16u>(d + i - 16) = a;
+        *ptr<v16u>(d + i - 32) = b;
+        *ptr<v16u>(d + i - 48) = c;
+        *ptr<v16u>(d + i - 64) = e;
+    }
+    for (; i > 16; i -= 16) {
+        asm("" : "+r"(d));
+        *ptr<v16u>(d + i - 16) = *ptr<v16u const>(s + i - 16);
+    }
+    *ptr<v16u>(d) = head;
+    return dest;
+}
+
+// returns 16 bytes at `p` as a byte vector
+auto inline load(u8 const* const p) -> v16b { return *ptr<v16bu const>(p); }
+
+// returns bit mask of bytes that differ between 16 bytes at `a` and `b`
+auto inline differ(u8 const* const a, u8 const* const b) -> u32 {
+    auto const equal = load(a) == load(b);
+    return ~u32(__builtin_ia32_pmovmskb128(v16b(equal))) & 0xffff;
+}
+
+// returns the difference of the first differing bytes, 0 if equal
+auto inline compare(void const* const lhs, void const* const rhs, u64 const n)
+    -> i32 {
+    auto const* const a = ptr<u8>(lhs);
+    auto const* const b = ptr<u8>(rhs);
+
+    if (n < 16) {
+        // head and tail words, overlapping
+        auto i = 0ull;
+        if (n >= 8) {
+            auto const head = *ptr<u64u const>(a) ^ *ptr<u64u const>(b);
+            auto const tail =
+                *ptr<u64u const>(a + n - 8) ^ *ptr<u64u const>(b + n - 8);
+            if (head == 0 && tail == 0) {
+                return 0;
+            }
+            i = head ? u32(__builtin_ctzll(head)) / 8
+                     : n - 8 + u32(__builtin_ctzll(tail)) / 8;
+            return i32(a[i]) - i32(b[i]);
+        }
+        for (; i < n; ++i) {
+            if (a[i] != b[i]) {
+                return i32(a[i]) - i32(b[i]);
+            }
+        }
+        return 0;
+    }
+
+    // 64 bytes at a time until a block differs, then 16
+    auto i = 0ull;
+    for (; i + 64 <= n; i += 64) {
+        auto const equal = (load(a + i) == load(b + i)) &
+                           (load(a + i + 16) == load(b + i + 16)) &
+                           (load(a + i + 32) == load(b + i + 32)) &
+                           (load(a + i + 48) == load(b + i + 48));
+        if (__builtin_ia32_pmovmskb128(v16b(equal)) != 0xffff) {
+            break;
+        }
+    }
+    for (; i + 16 <= n; i += 16) {
+        if (auto const mask = differ(a + i, b + i)) {
+            auto const at = i + u32(__builtin_ctz(mask));
+            return i32(a[at]) - i32(b[at]);
+        }
+    }
+    // tail ending at the last byte, the overlap compared equal
+    if (i < n) {
+        i = n - 16;
+        if (auto const mask = differ(a + i, b + i)) {
+            auto const at = i + u32(__builtin_ctz(mask));
+            return i32(a[at]) - i32(b[at]);
+        }
+    }
+    return 0;
+}
+
+// returns bit mask of bytes equal to `needle` in 16 bytes at `p`
+auto inline matches(u8 const* const p, v16b const needle) -> u32 {
+    auto const equal = load(p) == needle;
+    return u32(__builtin_ia32_pmovmskb128(v16b(equal)));
+}
+
+// returns first byte `c` in `n` bytes at `src`, nullptr if none
+// note: never reads past the `n` bytes
+auto inline find(void const* const src, u8 const c, u64 const n) -> void* {
+    auto const* const s = ptr<u8>(src);
+
+    auto i = 0ull;
+    if (n >= 16) {
+        auto const needle = v16b{} + char(c);
+        // 64 bytes at a time until a block matches, then 16
+        for (; i + 64 <= n; i += 64) {
+            auto const equal = (load(s + i) == needle) |
+                               (load(s + i + 16) == needle) |
+                               (load(s + i + 32) == needle) |
+                               (load(s + i + 48) == needle);
+            if (__builtin_ia32_pmovmskb128(v16b(equal))) {
+                break;
+            }
+        }
+        for (; i + 16 <= n; i += 16) {
+            if (auto const mask = matches(s + i, needle)) {
+                return ptr<void>(uptr(s + i + u32(__builtin_ctz(mask))));
+            }
+        }
+        // tail ending at the last byte, the overlap had no match
+        if (i < n) {
+            i = n - 16;
+            if (auto const mask = matches(s + i, needle)) {
+                return ptr<void>(uptr(s + i + u32(__builtin_ctz(mask))));
+            }
+        }
+        return nullptr;
+    }
+
+    for (; i < n; ++i) {
+        if (s[i] == c) {
+            return ptr<void>(uptr(s + i));
+        }
+    }
+    return nullptr;
+}
+
+// zeroes `n` bytes with non-temporal stores that bypass the caches
+// note: for memory not read soon such as freed pages and cleared buffers;
+//       small sizes are stored normally
+auto inline zero(void* const dest, u64 const n) -> void {
+    if (n < 64) {
+        fill(dest, 0, n);
+        return;
+    }
+    fill_streaming(ptr<u8>(dest), 0, n);
+}
+
+} // namespace kernel::memory
@@ -8,18 +8,40 @@ namespace osca {
 
 namespace queue {
 
+// returned by `run` of a resumable job
+enum class Status : u8 {
+    // job is finished and is destroyed
+    Done,
+    // job continues later; requeued if other jobs are waiting, otherwise run
+    // again in place
+    Yield,
+    // job continues later after the jobs waiting in the queue
+    Requeue,
+};
+
+template <typename T>
+concept is_resumable_job = requires(T t) {
+    { t.run() } -> is_same<Status>;
+} && __is_trivially_copyable(T);
+// note: trivially copyable because a requeued job is moved with `memcpy`
+
 template <typename T>
 concept is_job = requires(T t) {
     { t.run() } -> is_same<void>;
-};
+} || is_resumable_job<T>;
 
 //
 // single-producer, multi-consumer lock-free job queue
 //
 // thread safety:
 //  * try_add(), add(): single producer thread only
-//  * run_next(): multiple consumer threads safe
-//  * wait_idle(): safe from producer thread
+//  * try_add_cancellable(), add_cancellable(): single producer thread only
+//  * cancel(): any thread
+//  * try_add_until(), try_add_for(): single producer thread only
+//  * run_next(), run_next_until(), run_next_for(): multiple consumer threads
+//    safe
+//  * wait_idle(), wait_until(), done(): safe from producer thread
+//  * active_count(): any thread
 //
 // constraints:
 //  * max job parameters size: 48 bytes
@@ -31,7 +53,11 @@ template <u32 QueueSize = 256> class Spmc final {
         (QueueSize & (QueueSize - 1)) == 0 && QueueSize > 1,
         "QueueSize must be a power of 2 for efficient modulo operations");
 
-    using Func = auto (*)(void*) -> void;
+    // called when `active_count` crosses a watermark
+    using Callback = auto (*)(u32 active_count) -> void;
+
+    // runs the job if `run` is true, then destroys it
+    using Func = auto (*)(void* data, bool run) -> void;
 
     static auto constexpr JOB_SIZE =
         kernel::core::CACHE_LINE_SIZE - sizeof(Func) - 2 * sizeof(u32);
@@ -40,19 +66,43 @@ template <u32 QueueSize = 256> class Spmc final {
         u8 data[JOB_SIZE];
         Func func;
         u32 sequence;
-        u32 unused;
+        // one of `STATE_*`, cancellable jobs have the generation in upper bits
+        u32 state;
     };
 
+    // job cannot be cancelled
+    static auto constexpr STATE_PLAIN = 0u;
+    // job can be cancelled and has not been claimed by a consumer
+    static auto constexpr STATE_PENDING = 1u;
+    // job was cancelled before claimed by a consumer
+    static auto constexpr STATE_CANCELLED = 2u;
+    static auto constexpr STATE_MASK = 3u;
+
     static_assert(sizeof(Entry) == kernel::core::CACHE_LINE_SIZE);
 
+    // `active_count` is below `high_` or has dropped to `low_`
+    static auto constexpr THROTTLE_OFF = 0u;
+    // `high_` was reached and `on_high_` is running
+    static auto constexpr THROTTLE_RAISING = 1u;
+    // `high_` was reached and `active_count` has not dropped to `low_`
+    static auto constexpr THROTTLE_ON = 2u;
+    // `active_count` dropped to `low_` and `on_low_` is running
+    static auto constexpr THROTTLE_LOWERING = 3u;
+    // note: callbacks run in the transient states so `on_high` and `on_low`
+    //       never overlap nor arrive out of order
+
     // note: different cache lines avoiding false sharing
 
     // producer reads and writes, consumers atomically read and write
     alignas(kernel::core::CACHE_LINE_SIZE) Entry queue_[QueueSize];
 
-    // producer reads and writes
+    // producer reads and writes, consumers atomically read
     alignas(kernel::core::CACHE_LINE_SIZE) u32 head_;
 
+    // producer reads and writes
+    // note: tickets below this have completed
+    u32 watermark_;
+
     // consumers atomically read and write
     alignas(kernel::core::CACHE_LINE_SIZE) u32 tail_;
 
@@ -62,63 +112,179 @@ template <u32 QueueSize = 256> class Spmc final {
     // make sure `completed_` is alone on cache line
     u8 padding[kernel::core::CACHE_LINE_SIZE - sizeof(completed_)];
 
+    // backpressure configuration, see `set_watermarks`
+    // note: read-mostly, `throttled_` written only when crossing watermarks
+    alignas(kernel::core::CACHE_LINE_SIZE) u32 low_;
+    u32 high_;
+    Callback on_high_;
+    Callback on_low_;
+    // one of `THROTTLE_*`
+    u32 throttled_;
+
   public:
+    // identifies a job added to the queue
+    struct Handle {
+        // index of entry in queue or `QueueSize` if job was not added
+        u32 slot;
+        // value of entry `sequence` that handed the job to consumers
+        // note: also the ticket for `wait_until`
+        u32 generation;
+
+        explicit operator bool() const { return slot != QueueSize; }
+    };
+
     // safe to run while threads are running attempting `run_next` if assumed
     // zero initialized in data section
     auto init() -> void {
         head_ = 0;
+        watermark_ = 0;
         tail_ = 0;
         completed_ = 0;
+        low_ = 0;
+        high_ = 0;
+        on_high_ = nullptr;
+        on_low_ = nullptr;
+        throttled_ = THROTTLE_OFF;
         for (auto i = 0u; i < QueueSize; ++i) {
             queue_[i].sequence = i;
         }
     }
 
+    // called from producer before adding jobs
+    // `on_high` is called when `active_count` reaches `high`, then `on_low`
+    // when it drops to `low`, letting producers shed or coalesce work before
+    // the queue is full
+    // note: callbacks run on the producer or consumer that crossed the
+    //       watermark and must be short
+    // note: a crossing while the other callback runs is seen at the next
+    //       add or completed job
+    // note: `high` 0 disables
+    // returns:
+    //   true if watermarks were set
+    //   false if `low` is not below `high`
+    auto set_watermarks(u32 const low, u32 const high, Callback const on_high,
+                        Callback const on_low) -> bool {
+        if (high != 0 && low >= high) {
+            return false;
+        }
+        low_ = low;
+        high_ = high;
+        on_high_ = on_high;
+        on_low_ = on_low;
+        throttled_ = THROTTLE_OFF;
+        return true;
+    }
+
     // called from producer
     // creates job into the queue
     // returns:
-    //   true if job placed in queue
-    //   false if queue was full
-    template <is_job T, typename... Args> auto try_add(Args&&... args) -> bool {
-        static_assert(sizeof(T) <= JOB_SIZE, "job too large for queue slot");
-
-        auto& entry = queue_[head_ % QueueSize];
+    //   handle with the ticket of the job, false if queue was full
+    template <is_job T, typename... Args>
+    auto try_add(Args&&... args) -> Handle {
+        return emplace<T>(false, 0, fwd<Args>(args)...);
+    }
 
-        // (1) paired with release (2)
-        if (atomic::load(&entry.sequence, atomic::ACQUIRE) != head_) {
-            // slot is not free from the previous lap
-            return false;
+    // called from producer
+    // blocks while queue is full
+    // returns:
+    //   handle with the ticket of the job
+    template <is_job T, typename... Args> auto add(Args&&... args) -> Handle {
+        while (true) {
+            auto const handle = try_add<T>(fwd<Args>(args)...);
+            if (handle) {
+                return handle;
+            }
+            kernel::core::pause();
         }
+    }
 
-        // prepare slot
-        new (entry.data) T{fwd<Args>(args)...};
-        entry.func = [](void* data) {
-            auto* const p = ptr<T>(data);
-            p->run();
-            p->~T();
-        };
-        ++head_;
+    // called from producer
+    // creates job into the queue, waiting while full until `deadline` in
+    // `kernel::core::rdtsc` ticks
+    // returns:
+    //   handle with the ticket of the job, false if deadline passed
+    template <is_job T, typename... Args>
+    auto try_add_until(u64 const deadline, Args&&... args) -> Handle {
+        return emplace<T>(false, deadline, fwd<Args>(args)...);
+    }
 
-        // hand over the slot to be run
-        // (3) paired with acquire (4)
-        atomic::store(&entry.sequence, head_, atomic::RELEASE);
+    // called from producer
+    // creates job into the queue, waiting while full at most `ticks`
+    // returns:
+    //   handle with the ticket of the job, false if time ran out
+    template <is_job T, typename... Args>
+    auto try_add_for(u64 const ticks, Args&&... args) -> Handle {
+        return try_add_until<T>(kernel::core::rdtsc() + ticks,
+                                fwd<Args>(args)...);
+    }
 
-        return true;
+    // called from producer
+    // creates job into the queue that can be withdrawn with `cancel`
+    // returns:
+    //   handle to the job, false if queue was full
+    template <is_job T, typename... Args>
+    auto try_add_cancellable(Args&&... args) -> Handle {
+        return emplace<T>(true, 0, fwd<Args>(args)...);
     }
 
     // called from producer
     // blocks while queue is full
-    template <is_job T, typename... Args> auto add(Args&&... args) -> void {
-        while (!try_add<T>(fwd<Args>(args)...)) {
+    template <is_job T, typename... Args>
+    auto add_cancellable(Args&&... args) -> Handle {
+        while (true) {
+            auto const handle = try_add_cancellable<T>(fwd<Args>(args)...);
+            if (handle) {
+                return handle;
+            }
             kernel::core::pause();
         }
     }
 
+    // called from any thread
+    // turns a job not yet claimed by a consumer into a no-op
+    // note: the generation keeps 30 bits, so a handle older than 2^30
+    //       additions to the queue may alias a newer job in its slot
+    // returns:
+    //   true if job will not run
+    //   false if job has been claimed, handle is from a previous lap or
+    //   handle is from a failed add
+    auto cancel(Handle const& handle) -> bool {
+        if (!handle) {
+            return false;
+        }
+
+        auto& entry = queue_[handle.slot];
+        auto const tag = handle.generation << 2;
+        auto expected = tag | STATE_PENDING;
+
+        // note: relaxed because no data is handed over; the consumer's
+        //       exchange of `state` sees either value
+        return atomic::compare_exchange(&entry.state, &expected,
+                                        tag | STATE_CANCELLED, false,
+                                        atomic::RELAXED, atomic::RELAXED);
+    }
+
+    // called from multiple consumers
+    // returns:
+    //   true if job was run
+    //   false if no job was run
+    auto run_next() -> bool { return run_next_until(0); }
+
+    // called from multiple consumers
+    // waits for a job at most `ticks`
+    // returns:
+    //   true if job was run
+    //   false if no job was run
+    auto run_next_for(u64 const ticks) -> bool {
+        return run_next_until(kernel::core::rdtsc() + ticks);
+    }
+
     // called from multiple consumers
+    // waits for a job until `deadline` in `kernel::core::rdtsc` ticks
     // returns:
     //   true if job was run
     //   false if no job was run
-    auto run_next() -> bool {
+    auto run_next_until(u64 const deadline) -> bool {
         // optimistic read; job data visible at (4), claimed at (7)
         // note: if `t` is stale, either sequence check or CAS will safely fail
         auto t = atomic::load(&tail_, atomic::RELAXED);
@@ -135,7 +301,12 @@ template <u32 QueueSize = 256> class Spmc final {
 
             if (diff < 0) {
                 // job not ready (producer hasn't reached here)
-                return false;
+                if (expired(deadline)) {
+                    return false;
+                }
+                kernel::core::pause();
+                t = atomic::load(&tail_, atomic::RELAXED);
+                continue;
             }
 
             if (diff > 0) {
@@ -152,7 +323,8 @@ template <u32 QueueSize = 256> class Spmc final {
             //       guaranteed by the acquire on `sequence` at (4)
             if (atomic::compare_exchange(&tail_, &t, t + 1, true,
                                          atomic::RELAXED, atomic::RELAXED)) {
-                entry.func(entry.data);
+                auto const run = claim(entry);
+                entry.func(entry.data, run);
 
                 // hand the slot back to the producer for the next lap
                 // (2) paired with acquire (1)
@@ -161,9 +333,18 @@ template <u32 QueueSize = 256> class Spmc final {
                 // increment completed and release job side-effects for
                 // `wait_idle`
                 // (5) paired with acquire (6)
-                atomic::add(&completed_, 1u, atomic::RELEASE);
+                // note: seq_cst for `check_high`, see (13)
+                atomic::add(&completed_, 1u, atomic::SEQ_CST);
 
-                return true;
+                check_low();
+
+                if (run) {
+                    return true;
+                }
+
+                // job was cancelled, skip to next
+                t = atomic::load(&tail_, atomic::RELAXED);
+                continue;
             }
 
             // job was taken by competing consumer or spurious fail happened,
@@ -172,11 +353,11 @@ template <u32 QueueSize = 256> class Spmc final {
         }
     }
 
-    // called from producer
     // intended to be used in status displays etc
     auto active_count() const -> u32 {
+        auto const head = atomic::load(&head_, atomic::RELAXED);
         auto const completed = atomic::load(&completed_, atomic::RELAXED);
-        return head_ - completed;
+        return head - completed;
     }
 
     // called from producer
@@ -191,6 +372,383 @@ template <u32 QueueSize = 256> class Spmc final {
             kernel::core::pause();
         }
     }
+
+    // called from producer
+    // spin until the job with `ticket` and all jobs added before it have
+    // finished
+    // note: unlike `wait_idle` this does not wait for jobs added later
+    auto wait_until(u32 const ticket) -> void {
+        watermark_ = advance_watermark(watermark_, ticket, true);
+    }
+
+    // called from producer
+    // returns true if the job with `ticket` and all jobs added before it have
+    // finished
+    auto done(u32 const ticket) -> bool {
+        watermark_ = advance_watermark(watermark_, ticket, false);
+        return i32(ticket - watermark_) <= 0;
+    }
+
+  private:
+    // called from producer
+    // creates job into the queue
+    // returns:
+    //   handle to the job, false if queue was full
+    // note: waits while queue is full until `deadline`, 0 for no wait
+    template <is_job T, typename... Args>
+    auto emplace(bool const cancellable, u64 const deadline, Args&&... args)
+        -> Handle {
+        static_assert(sizeof(T) <= JOB_SIZE, "job too large for queue slot");
+        static_assert(!is_resumable_job<T>,
+                      "resumable jobs need Mpmc, Spmc consumers cannot add");
+
+        auto const slot = head_ % QueueSize;
+        auto& entry = queue_[slot];
+
+        // (1) paired with release (2)
+        while (atomic::load(&entry.sequence, atomic::ACQUIRE) != head_) {
+            // slot is not free from the previous lap
+            if (expired(deadline)) {
+                return {QueueSize, 0};
+            }
+            kernel::core::pause();
+        }
+
+        // prepare slot
+        prepare<T>(entry, fwd<Args>(args)...);
+        // note: atomic because consumers read it in `check_low`
+        atomic::store(&head_, head_ + 1, atomic::RELAXED);
+
+        // note: atomic because a stale `cancel` may compare concurrently
+        atomic::store(&entry.state,
+                      cancellable ? (head_ << 2) | STATE_PENDING : STATE_PLAIN,
+                      atomic::RELAXED);
+
+        // hand over the slot to be run
+        // (3) paired with acquire (4)
+        atomic::store(&entry.sequence, head_, atomic::RELEASE);
+
+        check_high();
+
+        return {slot, head_};
+    }
+
+    // returns watermark advanced to `ticket` once the jobs have finished
+    // note: stops at the first unfinished job unless `wait`
+    auto advance_watermark(u32 w, u32 const ticket, bool const wait) const
+        -> u32 {
+        // a slot is reused only after its job finished, so jobs more than a
+        // lap before head have finished
+        // note: unsigned distance because a stale `w` may be more than 2^31
+        //       behind `ticket`
+        if (u32(head_ - w) > QueueSize) {
+            w = head_ - QueueSize;
+        }
+
+        while (i32(ticket - w) > 0) {
+            // job at `w` has finished when its slot was handed back for the
+            // next lap
+            // (10) paired with release (2)
+            // note: acquire is required to see job memory side-effects
+            auto const seq =
+                atomic::load(&queue_[w % QueueSize].sequence, atomic::ACQUIRE);
+            if (i32(seq - w) >= i32(QueueSize)) {
+                ++w;
+                continue;
+            }
+
+            if (!wait) {
+                break;
+            }
+
+            kernel::core::pause();
+        }
+
+        return w;
+    }
+
+    // called from producer after adding a job
+    auto check_high() -> void {
+        if (high_ == 0 ||
+            atomic::load(&throttled_, atomic::RELAXED) != THROTTLE_OFF) {
+            return;
+        }
+
+        auto const active = active_count();
+        if (active < high_) {
+            return;
+        }
+
+        // note: the one that flips `throttled_` calls back
+        // note: acquire to follow a previous `on_low`
+        auto expected = THROTTLE_OFF;
+        if (!atomic::compare_exchange(&throttled_, &expected, THROTTLE_RAISING,
+                                      false, atomic::ACQUIRE,
+                                      atomic::RELAXED)) {
+            return;
+        }
+        on_high_(active);
+
+        // (13) paired with seq_cst (14)
+        atomic::store(&throttled_, THROTTLE_ON, atomic::SEQ_CST);
+
+        // consumers that completed jobs before `THROTTLE_ON` skipped `low_`,
+        // so the queue may have drained already
+        // note: seq_cst with (14) and the increment of `completed_` ensures
+        //       either this sees their completions or they see the flip
+        auto const remaining = atomic::load(&head_, atomic::RELAXED) -
+                               atomic::load(&completed_, atomic::SEQ_CST);
+        if (remaining <= low_) {
+            lower(remaining);
+        }
+    }
+
+    // called from consumer after completing a job
+    auto check_low() -> void {
+        // note: common case is a read of a shared, rarely written cache line
+        // (14) paired with seq_cst (13)
+        if (atomic::load(&throttled_, atomic::SEQ_CST) != THROTTLE_ON) {
+            return;
+        }
+
+        auto const active = active_count();
+        if (active > low_) {
+            return;
+        }
+
+        lower(active);
+    }
+
+    // calls `on_low` if `high_` was reached
+    auto lower(u32 const active) -> void {
+        // note: the one that flips `throttled_` calls back
+        // note: acquire to follow `on_high`
+        auto expected = THROTTLE_ON;
+        if (!atomic::compare_exchange(&throttled_, &expected,
+                                      THROTTLE_LOWERING, false,
+                                      atomic::ACQUIRE, atomic::RELAXED)) {
+            return;
+        }
+        on_low_(active);
+
+        // note: release so a following `on_high` sees `on_low` effects
+        atomic::store(&throttled_, THROTTLE_OFF, atomic::RELEASE);
+    }
+
+    // returns true if `deadline` in `kernel::core::rdtsc` ticks has passed
+    // note: 0 has always passed
+    static auto expired(u64 const deadline) -> bool {
+        return deadline == 0 || kernel::core::rdtsc() >= deadline;
+    }
+
+    // called by consumer that claimed `entry`
+    // returns:
+    //   true if job is to be run
+    //   false if job was cancelled
+    static auto claim(Entry& entry) -> bool {
+        // note: `state` written by producer is visible through acquire on
+        //       `sequence`
+        if (atomic::load(&entry.state, atomic::RELAXED) == STATE_PLAIN) {
+            return true;
+        }
+
+        // races with `cancel`; whichever is first decides
+        auto const state =
+            atomic::exchange(&entry.state, STATE_PLAIN, atomic::RELAXED);
+        return (state & STATE_MASK) == STATE_PENDING;
+    }
+
+    // constructs job in `entry`
+    template <is_job T, typename... Args>
+    static auto prepare(Entry& entry, Args&&... args) -> void {
+        new (entry.data) T{fwd<Args>(args)...};
+        entry.func = [](void* data, bool const run) {
+            auto* const p = ptr<T>(data);
+            if (run) {
+                p->run();
+            }
+            p->~T();
+        };
+    }
+};
+
+//
+// per-job-type cost accounting
+//
+// jobs are keyed by the type-specific function of their queue entry; each core
+// records into its own table with plain stores and `report` aggregates the
+// tables on demand
+//
+// thread safety:
+//  * record(): one thread per core index
+//  * report(): any thread; concurrent records may be partially seen
+//
+// constraints:
+//  * job types per core: `TYPES`, further types are not recorded
+//
+class Costs final {
+  public:
+    // job types tracked per core
+    static auto constexpr TYPES = 32u;
+
+    // cost of a job type
+    struct Cost {
+        // function of the job type's queue entry, see `Mpmc::func_of`
+        void const* func;
+        u64 count;
+        u64 cycles;
+    };
+
+    // called from core `core_index` after running job of type `func`
+    auto record(u32 const core_index, void const* const func, u64 const cycles)
+        -> void {
+        auto& table = tables_[core_index];
+        auto i = (uptr(func) >> 4) % TYPES;
+        for (auto n = 0u; n < TYPES; ++n, i = (i + 1) % TYPES) {
+            auto& cost = table.costs[i];
+            auto const key = atomic::load(&cost.func, atomic::RELAXED);
+            if (key == func) {
+                // note: only this core writes; relaxed stores let `report`
+                //       read without tearing
+                atomic::store(&cost.count, cost.count + 1, atomic::RELAXED);
+                atomic::store(&cost.cycles, cost.cycles + cycles,
+                              atomic::RELAXED);
+                return;
+            }
+            if (key == nullptr) {
+                atomic::store(&cost.count, 1ull, atomic::RELAXED);
+                atomic::store(&cost.cycles, cycles, atomic::RELAXED);
+                // (1) paired with acquire (2)
+                atomic::store(&cost.func, func, atomic::RELEASE);
+                return;
+            }
+        }
+        // note: table full, type not recorded
+    }
+
+    // aggregates costs of all cores into `costs` sorted by total cycles,
+    // highest first
+    // returns:
+    //   number of job types written, at most `capacity`
+    auto report(Cost* const costs, u32 const capacity) const -> u32 {
+        auto count = 0u;
+        for (auto const& table : tables_) {
+            for (auto const& cost : table.costs) {
+                // (2) paired with release (1)
+                auto const func = atomic::load(&cost.func, atomic::ACQUIRE);
+                if (func == nullptr) {
+                    continue;
+                }
+
+                auto i = 0u;
+                while (i < count && costs[i].func != func) {
+                    ++i;
+                }
+                if (i == count) {
+                    if (count == capacity) {
+                        continue;
+                    }
+                    costs[count++] = {func, 0, 0};
+                }
+                costs[i].count += atomic::load(&cost.count, atomic::RELAXED);
+                costs[i].cycles +=
+                    atomic::load(&cost.cycles, atomic::RELAXED);
+            }
+        }
+
+        // insertion sort; few types
+        for (auto i = 1u; i < count; ++i) {
+            auto const cost = costs[i];
+            auto j = i;
+            while (j > 0 && costs[j - 1].cycles < cost.cycles) {
+                costs[j] = costs[j - 1];
+                --j;
+            }
+            costs[j] = cost;
+        }
+
+        return count;
+    }
+
+  private:
+    struct alignas(kernel::core::CACHE_LINE_SIZE) Table {
+        Cost costs[TYPES];
+    };
+
+    // core reads and writes its own table
+    Table tables_[kernel::MAX_CORES];
+};
+
+//
+// per-core bump-pointer arenas for temporary buffers of jobs
+//
+// a queue given the arenas with `set_scratch` resets the core's arena after
+// each job run by `run_next(core_index)` so temporary allocation is a pointer
+// increment and nothing is freed
+//
+// usage:
+//   kernel at start for each core:
+//     osca::scratch.init(i, kernel::alloc::allocate(size), size);
+//   job:
+//     auto* const buffer = osca::scratch.allocate_array<u32>(1024);
+//
+// thread safety:
+//  * init(): before the core runs jobs
+//  * allocate(), allocate_array(), used(): from the calling core
+//  * reset(): from the owning core
+//
+// constraints:
+//  * memory is valid until the job returns; a resumable job must not keep it
+//    across runs
+//
+class Scratch final {
+    struct alignas(kernel::core::CACHE_LINE_SIZE) Arena {
+        uptr start;
+        uptr next;
+        uptr end;
+    };
+
+    // note: only accessed by the owning core, no atomics needed
+    Arena arenas_[kernel::MAX_CORES];
+
+  public:
+    // gives core `core_index` `size` bytes at `memory`
+    auto init(u32 const core_index, void* const memory, usize const size)
+        -> void {
+        auto& arena = arenas_[core_index];
+        arena.start = uptr(memory);
+        arena.next = arena.start;
+        arena.end = arena.start + size;
+    }
+
+    // returns `size` bytes aligned to `align` (power of 2) from the calling
+    // core's arena, nullptr if exhausted
+    auto allocate(usize const size, usize const align = 16) -> void* {
+        auto& arena = arenas_[kernel::core::index()];
+        auto const p = (arena.next + align - 1) & ~uptr(align - 1);
+        if (p + size > arena.end) {
+            return nullptr;
+        }
+        arena.next = p + size;
+        return ptr<void>(p);
+    }
+
+    // returns uninitialized array of `count` `T`, nullptr if exhausted
+    template <typename T> auto allocate_array(usize const count) -> T* {
+        return ptr<T>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // returns bytes allocated from the calling core's arena
+    auto used() const -> usize {
+        auto const& arena = arenas_[kernel::core::index()];
+        return arena.next - arena.start;
+    }
+
+    // frees everything allocated from core `core_index`'s arena
+    auto reset(u32 const core_index) -> void {
+        auto& arena = arenas_[core_index];
+        arena.next = arena.start;
+    }
 };
 
 //
@@ -198,19 +756,37 @@ template <u32 QueueSize = 256> class Spmc final {
 //
 // thread safety:
 //  * try_add(), add(): multiple producer threads safe
-//  * run_next(): multiple consumer threads safe
+//  * try_add_cancellable(), add_cancellable(): multiple producer threads safe
+//  * cancel(): any thread
+//  * try_add_local(), add_local(): same as try_add() and add()
+//  * try_add_until(), try_add_for(): multiple producer threads safe
+//  * run_next(), run_next_until(), run_next_for(): multiple consumer threads
+//    safe
+//  * run_next(core_index): one consumer thread per core index
+//  * set_costs(), set_scratch(), set_idle(): before consumers start
+//  * wait_idle(), wait_until(), done(): any thread
 //
 // constraints:
 //  * max job parameters size: 48 bytes
 //  * queue capacity: configurable through template argument (power of 2)
 //  * safe to be interrupted and interrupt to add job
+//  * a resumable job that is requeued gets a new ticket; the old ticket
+//    completes and its handle can no longer cancel
+//  * a resumable job run again in place keeps its ticket until it is done,
+//    unless the queue is full and its consumer runs waiting jobs first; then
+//    the job is moved off its slot and the ticket completes
 //
 template <u32 QueueSize = 256> class Mpmc final {
     static_assert(
         (QueueSize & (QueueSize - 1)) == 0 && QueueSize > 1,
         "QueueSize must be a power of 2 for efficient modulo operations");
 
-    using Func = auto (*)(void*) -> void;
+    // called when `active_count` crosses a watermark
+    using Callback = auto (*)(u32 active_count) -> void;
+    using Idle = auto (*)(u32 core_index) -> void;
+
+    // runs the job if `run` is true, then destroys it unless not done
+    using Func = auto (*)(void* data, bool run) -> Status;
 
     static auto constexpr JOB_SIZE =
         kernel::core::CACHE_LINE_SIZE - sizeof(Func) - 2 * sizeof(u32);
@@ -219,11 +795,31 @@ template <u32 QueueSize = 256> class Mpmc final {
         u8 data[JOB_SIZE];
         Func func;
         u32 sequence;
-        u32 unused;
+        // one of `STATE_*`, cancellable jobs have the generation in upper bits
+        u32 state;
     };
 
+    // job cannot be cancelled
+    static auto constexpr STATE_PLAIN = 0u;
+    // job can be cancelled and has not been claimed by a consumer
+    static auto constexpr STATE_PENDING = 1u;
+    // job was cancelled before claimed by a consumer
+    static auto constexpr STATE_CANCELLED = 2u;
+    static auto constexpr STATE_MASK = 3u;
+
     static_assert(sizeof(Entry) == kernel::core::CACHE_LINE_SIZE);
 
+    // `active_count` is below `high_` or has dropped to `low_`
+    static auto constexpr THROTTLE_OFF = 0u;
+    // `high_` was reached and `on_high_` is running
+    static auto constexpr THROTTLE_RAISING = 1u;
+    // `high_` was reached and `active_count` has not dropped to `low_`
+    static auto constexpr THROTTLE_ON = 2u;
+    // `active_count` dropped to `low_` and `on_low_` is running
+    static auto constexpr THROTTLE_LOWERING = 3u;
+    // note: callbacks run in the transient states so `on_high` and `on_low`
+    //       never overlap nor arrive out of order
+
     // note: different cache lines avoiding false sharing
 
     // producer reads and writes, consumers atomically read and write
@@ -241,49 +837,417 @@ template <u32 QueueSize = 256> class Mpmc final {
     // make sure `completed_` is alone on cache line
     u8 padding[kernel::core::CACHE_LINE_SIZE - sizeof(completed_)];
 
+    // backpressure configuration, see `set_watermarks`
+    // note: read-mostly, `throttled_` written only when crossing watermarks
+    alignas(kernel::core::CACHE_LINE_SIZE) u32 low_;
+    u32 high_;
+    Callback on_high_;
+    Callback on_low_;
+    // one of `THROTTLE_*`
+    u32 throttled_;
+    // cost accounting, see `set_costs`
+    Costs* costs_;
+    // arenas reset after each job, see `set_scratch`
+    Scratch* scratch_;
+    // background work of idle consumers, see `set_idle`
+    Idle on_idle_;
+
+    // waiters atomically read and write
+    // note: tickets below this have completed
+    alignas(kernel::core::CACHE_LINE_SIZE) u32 watermark_;
+
+    // make sure `watermark_` is alone on cache line
+    u8 watermark_padding[kernel::core::CACHE_LINE_SIZE - sizeof(watermark_)];
+
+    // slot for a job added by the job running on the core
+    // note: only accessed by the owning core, no atomics needed
+    struct alignas(kernel::core::CACHE_LINE_SIZE) Local {
+        // note: two entries so a running local job can add the next one
+        Entry entries[2];
+        // index in `entries` where the next job is placed
+        u32 next;
+        // true if `entries[next]` holds a job
+        bool pending;
+        // true while `run_next(core_index)` runs a job on the core
+        bool running;
+    };
+
+    // owning core reads and writes
+    Local locals_[kernel::MAX_CORES];
+
   public:
+    // identifies a job added to the queue
+    struct Handle {
+        // index of entry in queue or `QueueSize` if job was not added
+        u32 slot;
+        // value of entry `sequence` that handed the job to consumers
+        // note: also the ticket for `wait_until`
+        u32 generation;
+
+        explicit operator bool() const { return slot != QueueSize; }
+    };
+
     // safe to run while threads are running attempting `run_next` if assumed
     // zero initialized in data section
     auto init() -> void {
         head_ = 0;
         tail_ = 0;
         completed_ = 0;
+        low_ = 0;
+        high_ = 0;
+        on_high_ = nullptr;
+        on_low_ = nullptr;
+        throttled_ = THROTTLE_OFF;
+        costs_ = nullptr;
+        scratch_ = nullptr;
+        on_idle_ = nullptr;
+        watermark_ = 0;
         for (auto i = 0u; i < QueueSize; ++i) {
             queue_[i].sequence = i;
         }
+        for (auto& local : locals_) {
+            local.next = 0;
+            local.pending = false;
+            local.running = false;
+        }
+    }
+
+    // called from producer before adding jobs
+    // `on_high` is called when `active_count` reaches `high`, then `on_low`
+    // when it drops to `low`, letting producers shed or coalesce work before
+    // the queue is full
+    // note: callbacks run on the producer or consumer that crossed the
+    //       watermark and must be short
+    // note: a crossing while the other callback runs is seen at the next
+    //       add or completed job
+    // note: `high` 0 disables
+    // returns:
+    //   true if watermarks were set
+    //   false if `low` is not below `high`
+    auto set_watermarks(u32 const low, u32 const high, Callback const on_high,
+                        Callback const on_low) -> bool {
+        if (high != 0 && low >= high) {
+            return false;
+        }
+        low_ = low;
+        high_ = high;
+        on_high_ = on_high;
+        on_low_ = on_low;
+        throttled_ = THROTTLE_OFF;
+        return true;
+    }
+
+    // called before consumers start
+    // records cycles and count per job type run by `run_next(core_index)`
+    // into `costs`
+    // note: nullptr disables
+    auto set_costs(Costs* const costs) -> void { costs_ = costs; }
+
+    // called before consumers start
+    // resets the core's arena in `scratch` after each job run by
+    // `run_next(core_index)`
+    // note: nullptr disables
+    auto set_scratch(Scratch* const scratch) -> void { scratch_ = scratch; }
+
+    // called before consumers start
+    // `on_idle` is called by `run_next(core_index)` when it finds no job, for
+    // low-priority background work such as zeroing pages
+    // note: runs on the idle consumer and must do a bounded amount of work
+    // note: nullptr disables
+    auto set_idle(Idle const on_idle) -> void { on_idle_ = on_idle; }
+
+    // returns the key of job type `T` in `Costs`
+    template <is_job T> static auto func_of() -> void const* {
+        return ptr<void const>(uptr(&invoke<T>));
     }
 
     // called from multiple producers
     // creates job into the queue
     // returns:
-    //   true if job placed in queue
-    //   false if queue was full
-    template <is_job T, typename... Args> auto try_add(Args&&... args) -> bool {
-        static_assert(sizeof(T) <= JOB_SIZE, "job too large for queue slot");
-
-        // optimistic read; job data visible at (1) and claimed at (8)
-        // note: if `h` is stale either sequence check or CAS fails safely
-        auto h = atomic::load(&head_, atomic::RELAXED);
+    //   handle with the ticket of the job, false if queue was full
+    template <is_job T, typename... Args>
+    auto try_add(Args&&... args) -> Handle {
+        return emplace<T>(false, 0, fwd<Args>(args)...);
+    }
 
+    // called from multiple producers
+    // blocks while queue is full
+    // returns:
+    //   handle with the ticket of the job
+    template <is_job T, typename... Args> auto add(Args&&... args) -> Handle {
         while (true) {
-            auto& entry = queue_[h % QueueSize];
-
-            // (1) paired with release (2)
-            auto const seq = atomic::load(&entry.sequence, atomic::ACQUIRE);
-
-            // signed difference correctly handles u32 wrap-around
-            auto const diff = i32(seq - h);
-
-            if (diff > 0) {
-                // `seq` is ahead of `h` -> competing producer took slot
-                h = atomic::load(&head_, atomic::RELAXED);
-                continue;
+            auto const handle = try_add<T>(fwd<Args>(args)...);
+            if (handle) {
+                return handle;
             }
+            kernel::core::pause();
+        }
+    }
 
-            if (diff < 0) {
-                // `seq` is behind `h` -> queue is full
-                return false;
-            }
+    // called from multiple producers
+    // creates job into the queue, waiting while full until `deadline` in
+    // `kernel::core::rdtsc` ticks
+    // returns:
+    //   handle with the ticket of the job, false if deadline passed
+    template <is_job T, typename... Args>
+    auto try_add_until(u64 const deadline, Args&&... args) -> Handle {
+        return emplace<T>(false, deadline, fwd<Args>(args)...);
+    }
+
+    // called from multiple producers
+    // creates job into the queue, waiting while full at most `ticks`
+    // returns:
+    //   handle with the ticket of the job, false if time ran out
+    template <is_job T, typename... Args>
+    auto try_add_for(u64 const ticks, Args&&... args) -> Handle {
+        return try_add_until<T>(kernel::core::rdtsc() + ticks,
+                                fwd<Args>(args)...);
+    }
+
+    // called from multiple producers
+    // creates job into the queue that can be withdrawn with `cancel`
+    // returns:
+    //   handle to the job, false if queue was full
+    template <is_job T, typename... Args>
+    auto try_add_cancellable(Args&&... args) -> Handle {
+        return emplace<T>(true, 0, fwd<Args>(args)...);
+    }
+
+    // called from multiple producers
+    // blocks while queue is full
+    template <is_job T, typename... Args>
+    auto add_cancellable(Args&&... args) -> Handle {
+        while (true) {
+            auto const handle = try_add_cancellable<T>(fwd<Args>(args)...);
+            if (handle) {
+                return handle;
+            }
+            kernel::core::pause();
+        }
+    }
+
+    // called from any thread
+    // turns a job not yet claimed by a consumer into a no-op
+    // note: the generation keeps 30 bits, so a handle older than 2^30
+    //       additions to the queue may alias a newer job in its slot
+    // returns:
+    //   true if job will not run
+    //   false if job has been claimed, handle is from a previous lap or
+    //   handle is from a failed add
+    auto cancel(Handle const& handle) -> bool {
+        if (!handle) {
+            return false;
+        }
+
+        auto& entry = queue_[handle.slot];
+        auto const tag = handle.generation << 2;
+        auto expected = tag | STATE_PENDING;
+
+        // note: relaxed because no data is handed over; the consumer's
+        //       exchange of `state` sees either value
+        return atomic::compare_exchange(&entry.state, &expected,
+                                        tag | STATE_CANCELLED, false,
+                                        atomic::RELAXED, atomic::RELAXED);
+    }
+
+    // called from a job run by `run_next(core_index)`
+    // places job in the core's local slot to be run next by the same core
+    // while its cache is warm
+    // note: falls back to `try_add` if the slot is taken or the caller is not
+    //       a job run by `run_next(core_index)`
+    // returns:
+    //   true if job placed in local slot or queue
+    //   false if queue was full
+    template <is_job T, typename... Args>
+    auto try_add_local(Args&&... args) -> bool {
+        static_assert(sizeof(T) <= JOB_SIZE, "job too large for queue slot");
+
+        auto& local = locals_[kernel::core::index()];
+        if (!local.running || local.pending) {
+            return bool(try_add<T>(fwd<Args>(args)...));
+        }
+
+        // prepare slot
+        prepare<T>(local.entries[local.next], fwd<Args>(args)...);
+        local.pending = true;
+
+        return true;
+    }
+
+    // called from a job run by `run_next(core_index)`
+    // blocks while queue is full and local slot is taken
+    // note: deadlocks if every consumer blocks here on a full queue; prefer
+    //       `try_add_local` where that can happen
+    template <is_job T, typename... Args>
+    auto add_local(Args&&... args) -> void {
+        while (!try_add_local<T>(fwd<Args>(args)...)) {
+            kernel::core::pause();
+        }
+    }
+
+    // called from multiple consumers
+    // returns:
+    //   true if job was run
+    //   false if no job was run
+    auto run_next() -> bool { return run_shared(nullptr, 0, true); }
+
+    // called from multiple consumers
+    // waits for a job at most `ticks`
+    // returns:
+    //   true if job was run
+    //   false if no job was run
+    auto run_next_for(u64 const ticks) -> bool {
+        return run_next_until(kernel::core::rdtsc() + ticks);
+    }
+
+    // called from multiple consumers
+    // waits for a job until `deadline` in `kernel::core::rdtsc` ticks
+    // returns:
+    //   true if job was run
+    //   false if no job was run
+    auto run_next_until(u64 const deadline) -> bool {
+        return run_shared(nullptr, deadline, true);
+    }
+
+    // called from the consumer on core `core_index`
+    // runs the job in the core's local slot, if any, before the queue
+    // note: calls `on_idle` when no job was run
+    // returns:
+    //   true if job was run
+    //   false if no job was run
+    auto run_next(u32 const core_index) -> bool {
+        auto& local = locals_[core_index];
+        local.running = true;
+
+        auto ran = true;
+        if (local.pending) {
+            auto& entry = local.entries[local.next];
+            // note: job added by this job is placed in the other entry
+            local.next ^= 1;
+            local.pending = false;
+            resume(entry, call(entry, true, &local), &local, true, nullptr);
+            complete(&local);
+        } else {
+            ran = run_shared(&local, 0, true);
+        }
+
+        local.running = false;
+
+        if (!ran && on_idle_) {
+            on_idle_(core_index);
+        }
+
+        return ran;
+    }
+
+    // intended to be used in status displays etc
+    auto active_count() const -> u32 {
+        auto const head = atomic::load(&head_, atomic::RELAXED);
+        auto const completed = atomic::load(&completed_, atomic::RELAXED);
+        return head - completed;
+    }
+
+    // spin until all work is finished
+    auto wait_idle() const -> void {
+        while (true) {
+            auto const head = atomic::load(&head_, atomic::RELAXED);
+            // note: relaxed is safe; thread sees its own prior additions
+
+            // (6) paired with release (5)
+            // note: acquire is required to see job memory side-effects
+            auto const completed = atomic::load(&completed_, atomic::ACQUIRE);
+
+            if (head == completed) {
+                return;
+            }
+
+            kernel::core::pause();
+        }
+    }
+
+    // spin until the job with `ticket` and all jobs added before it have
+    // finished
+    // note: unlike `wait_idle` this does not wait for jobs added later by
+    //       other producers nor for jobs added with `add_local`
+    auto wait_until(u32 const ticket) -> void { watch(ticket, true); }
+
+    // returns true if the job with `ticket` and all jobs added before it have
+    // finished
+    auto done(u32 const ticket) -> bool {
+        return i32(ticket - watch(ticket, false)) <= 0;
+    }
+
+  private:
+    // called from multiple producers
+    // creates job into the queue
+    // returns:
+    //   handle to the job, false if queue was full
+    // note: waits while queue is full until `deadline`, 0 for no wait
+    template <is_job T, typename... Args>
+    auto emplace(bool const cancellable, u64 const deadline, Args&&... args)
+        -> Handle {
+        static_assert(sizeof(T) <= JOB_SIZE, "job too large for queue slot");
+
+        auto h = 0u;
+        if (!reserve(deadline, h)) {
+            return {QueueSize, 0};
+        }
+
+        auto& entry = queue_[h % QueueSize];
+
+        // prepare slot
+        prepare<T>(entry, fwd<Args>(args)...);
+
+        // note: atomic because a stale `cancel` may compare concurrently
+        atomic::store(&entry.state,
+                      cancellable ? ((h + 1) << 2) | STATE_PENDING
+                                  : STATE_PLAIN,
+                      atomic::RELAXED);
+
+        // hand over the slot to be run
+        // (3) paired with acquire (4)
+        atomic::store(&entry.sequence, h + 1, atomic::RELEASE);
+        // note: release publishes job data and gives ownership to consumer
+
+        check_high();
+
+        return {h % QueueSize, h + 1};
+    }
+
+    // claims the slot at head for a producer
+    // returns:
+    //   true and `h` the claimed position
+    //   false if queue was full
+    // note: waits while queue is full until `deadline`, 0 for no wait
+    auto reserve(u64 const deadline, u32& h) -> bool {
+        // optimistic read; job data visible at (1) and claimed at (8)
+        // note: if `h` is stale either sequence check or CAS fails safely
+        h = atomic::load(&head_, atomic::RELAXED);
+
+        while (true) {
+            auto& entry = queue_[h % QueueSize];
+
+            // (1) paired with release (2)
+            auto const seq = atomic::load(&entry.sequence, atomic::ACQUIRE);
+
+            // signed difference correctly handles u32 wrap-around
+            auto const diff = i32(seq - h);
+
+            if (diff > 0) {
+                // `seq` is ahead of `h` -> competing producer took slot
+                h = atomic::load(&head_, atomic::RELAXED);
+                continue;
+            }
+
+            if (diff < 0) {
+                // `seq` is behind `h` -> queue is full
+                if (expired(deadline)) {
+                    return false;
+                }
+                kernel::core::pause();
+                h = atomic::load(&head_, atomic::RELAXED);
+                continue;
+            }
 
             // `seq` is `h` -> slot is ready, try to claim it
 
@@ -292,20 +1256,6 @@ template <u32 QueueSize = 256> class Mpmc final {
             //       `sequence`
             if (atomic::compare_exchange(&head_, &h, h + 1, true,
                                          atomic::RELAXED, atomic::RELAXED)) {
-                // prepare slot
-                new (entry.data) T{fwd<Args>(args)...};
-                entry.func = [](void* data) {
-                    auto* const p = ptr<T>(data);
-                    p->run();
-                    p->~T();
-                };
-
-                // hand over the slot to be run
-                // (3) paired with acquire (4)
-                atomic::store(&entry.sequence, h + 1, atomic::RELEASE);
-                // note: release publishes job data and gives ownership to
-                //       consumer
-
                 return true;
             }
 
@@ -314,19 +1264,120 @@ template <u32 QueueSize = 256> class Mpmc final {
         }
     }
 
-    // called from multiple producers
-    // blocks while queue is full
-    template <is_job T, typename... Args> auto add(Args&&... args) -> void {
-        while (!try_add<T>(fwd<Args>(args)...)) {
-            kernel::core::pause();
+    // called by consumer after running job in `entry`
+    // runs the job again until it is done or has been requeued, then hands
+    // back its slot
+    // note: `t` is the position of the slot holding `entry`, nullptr if it is
+    //       a core's local entry
+    // note: while the queue is full, waiting jobs are run to make room if
+    //       `drain`; jobs run that way are not done draining themselves so
+    //       the stack holds at most two unfinished jobs
+    auto resume(Entry& entry, Status status, Local const* const local,
+                bool const drain, u32 const* t) -> void {
+        auto* job = &entry;
+        Entry held;
+        while (status != Status::Done) {
+            if (status == Status::Yield && !waiting()) {
+                // nothing to yield to
+                status = call(*job, true, local);
+                continue;
+            }
+            if (t != nullptr && recycle(*job, *t)) {
+                return;
+            }
+            if (requeue(*job)) {
+                break;
+            }
+            if (drain) {
+                if (t != nullptr) {
+                    // move the job off its slot so jobs run to make room may
+                    // wait for its ticket
+                    // note: the ticket completes as when the job is moved
+                    memcpy(held.data, job->data, JOB_SIZE);
+                    held.func = job->func;
+                    release(*t);
+                    t = nullptr;
+                    job = &held;
+                }
+                if (run_shared(nullptr, 0, false)) {
+                    continue;
+                }
+            }
+            status = call(*job, true, local);
+        }
+
+        if (t != nullptr) {
+            release(*t);
         }
     }
 
-    // called from multiple consumers
+    // hands the slot of the job at position `t` back to the producer for the
+    // next lap
+    auto release(u32 const t) -> void {
+        // (2) paired with acquire (1)
+        atomic::store(&queue_[t % QueueSize].sequence, t + QueueSize,
+                      atomic::RELEASE);
+        // note: release makes the slot available for producer's next lap
+    }
+
+    // called by consumer holding the slot of the job at position `t`
+    // gives the job the next ticket in its own slot when producers wait for
+    // that slot, so a job running again does not block the queue
+    // note: the job's old ticket completes as when it is moved
     // returns:
-    //   true if job was run
-    //   false if no job was run
-    auto run_next() -> bool {
+    //   true if job kept its slot with a new ticket
+    //   false if producers do not wait for the slot
+    auto recycle(Entry& entry, u32 const t) -> bool {
+        auto h = t + QueueSize;
+        if (!atomic::compare_exchange(&head_, &h, h + 1, false,
+                                      atomic::RELAXED, atomic::RELAXED)) {
+            return false;
+        }
+
+        atomic::store(&entry.state, STATE_PLAIN, atomic::RELAXED);
+
+        // (3) paired with acquire (4)
+        // note: also completes ticket `t + 1` paired with acquire (10)
+        atomic::store(&entry.sequence, h + 1, atomic::RELEASE);
+
+        return true;
+    }
+
+    // called by consumer with a job that is not done
+    // moves the job from `from` to the tail of the queue
+    // returns:
+    //   true if job was moved
+    //   false if queue was full
+    auto requeue(Entry const& from) -> bool {
+        auto h = 0u;
+        if (!reserve(0, h)) {
+            return false;
+        }
+
+        auto& entry = queue_[h % QueueSize];
+        memcpy(entry.data, from.data, JOB_SIZE);
+        entry.func = from.func;
+        atomic::store(&entry.state, STATE_PLAIN, atomic::RELAXED);
+
+        // (3) paired with acquire (4)
+        atomic::store(&entry.sequence, h + 1, atomic::RELEASE);
+
+        return true;
+    }
+
+    // returns true if a job is ready to be claimed at tail
+    auto waiting() const -> bool {
+        auto const t = atomic::load(&tail_, atomic::RELAXED);
+        auto const seq =
+            atomic::load(&queue_[t % QueueSize].sequence, atomic::RELAXED);
+        return i32(seq - (t + 1)) >= 0;
+    }
+
+    // runs next job from the queue, waiting for one until `deadline`
+    // note: `local` is the slot of the calling core or nullptr
+    // note: `drain` is passed on to `resume`
+    auto run_shared(Local const* const local, u64 const deadline,
+                    bool const drain) -> bool {
         // optimistic read; job data visible at (4), claimed at (7)
         // note: if `t` is stale, either sequence check or CAS will safely fail
         auto t = atomic::load(&tail_, atomic::RELAXED);
@@ -343,7 +1394,12 @@ template <u32 QueueSize = 256> class Mpmc final {
 
             if (diff < 0) {
                 // job not ready (producer hasn't reached here)
-                return false;
+                if (expired(deadline)) {
+                    return false;
+                }
+                kernel::core::pause();
+                t = atomic::load(&tail_, atomic::RELAXED);
+                continue;
             }
 
             if (diff > 0) {
@@ -360,20 +1416,20 @@ template <u32 QueueSize = 256> class Mpmc final {
             //       guaranteed by the acquire on `sequence` at (4)
             if (atomic::compare_exchange(&tail_, &t, t + 1, true,
                                          atomic::RELAXED, atomic::RELAXED)) {
-                entry.func(entry.data);
+                auto const run = claim(entry);
 
-                // hand the slot back to the producer for the next lap
-                // (2) paired with acquire (1)
-                atomic::store(&entry.sequence, t + QueueSize, atomic::RELEASE);
-                // note: release makes the slot available for producer's next
-                //       lap
+                // note: an unfinished job keeps its slot until it is done or
+                //       moved so its ticket does not complete while it runs
+                resume(entry, call(entry, run, local), local, drain, &t);
+                complete(local);
 
-                // increment completed and release job side-effects for
-                // `wait_idle`
-                // (5) paired with acquire (6)
-                atomic::add(&completed_, 1u, atomic::RELEASE);
+                if (run) {
+                    return true;
+                }
 
-                return true;
+                // job was cancelled, skip to next
+                t = atomic::load(&tail_, atomic::RELAXED);
+                continue;
             }
 
             // job was taken by competing consumer or spurious fail happened,
@@ -382,34 +1438,490 @@ template <u32 QueueSize = 256> class Mpmc final {
         }
     }
 
+    // increment completed and release job side-effects for `wait_idle`
+    // note: a job added to the local slot by the job that just ran inherits
+    //       its completion so `head_ - completed_` stays the number of
+    //       active jobs
+    auto complete(Local const* const local) -> void {
+        if (local != nullptr && local->pending) {
+            return;
+        }
+
+        // (5) paired with acquire (6)
+        // note: seq_cst for `check_high`, see (13)
+        atomic::add(&completed_, 1u, atomic::SEQ_CST);
+
+        check_low();
+    }
+
+    // advances the shared watermark towards `ticket` and returns it
+    auto watch(u32 const ticket, bool const wait) -> u32 {
+        // (11) paired with release (12)
+        auto current = atomic::load(&watermark_, atomic::ACQUIRE);
+        auto const w = advance_watermark(current, ticket, wait);
+
+        // publish progress to other waiters, keeping the largest watermark
+        // (12) paired with acquire (11)
+        while (i32(w - current) > 0 &&
+               !atomic::compare_exchange(&watermark_, &current, w, true,
+                                         atomic::RELEASE, atomic::RELAXED)) {
+        }
+
+        return w;
+    }
+
+    // returns watermark advanced to `ticket` once the jobs have finished
+    // note: stops at the first unfinished job unless `wait`
+    auto advance_watermark(u32 w, u32 const ticket, bool const wait) const
+        -> u32 {
+        // a slot is reused only after its job finished, so jobs more than a
+        // lap before head have finished
+        // note: unsigned distance because a stale `w` may be more than 2^31
+        //       behind `ticket`
+        auto const head = atomic::load(&head_, atomic::RELAXED);
+        if (u32(head - w) > QueueSize) {
+            w = head - QueueSize;
+        }
+
+        while (i32(ticket - w) > 0) {
+            // job at `w` has finished when its slot was handed back for the
+            // next lap
+            // (10) paired with release (2)
+            // note: acquire is required to see job memory side-effects
+            auto const seq =
+                atomic::load(&queue_[w % QueueSize].sequence, atomic::ACQUIRE);
+            if (i32(seq - w) >= i32(QueueSize)) {
+                ++w;
+                continue;
+            }
+
+            if (!wait) {
+                break;
+            }
+
+            kernel::core::pause();
+        }
+
+        return w;
+    }
+
+    // called from producer after adding a job
+    auto check_high() -> void {
+        if (high_ == 0 ||
+            atomic::load(&throttled_, atomic::RELAXED) != THROTTLE_OFF) {
+            return;
+        }
+
+        auto const active = active_count();
+        if (active < high_) {
+            return;
+        }
+
+        // note: the one that flips `throttled_` calls back
+        // note: acquire to follow a previous `on_low`
+        auto expected = THROTTLE_OFF;
+        if (!atomic::compare_exchange(&throttled_, &expected, THROTTLE_RAISING,
+                                      false, atomic::ACQUIRE,
+                                      atomic::RELAXED)) {
+            return;
+        }
+        on_high_(active);
+
+        // (13) paired with seq_cst (14)
+        atomic::store(&throttled_, THROTTLE_ON, atomic::SEQ_CST);
+
+        // consumers that completed jobs before `THROTTLE_ON` skipped `low_`,
+        // so the queue may have drained already
+        // note: seq_cst with (14) and the increment of `completed_` ensures
+        //       either this sees their completions or they see the flip
+        auto const remaining = atomic::load(&head_, atomic::RELAXED) -
+                               atomic::load(&completed_, atomic::SEQ_CST);
+        if (remaining <= low_) {
+            lower(remaining);
+        }
+    }
+
+    // called from consumer after completing a job
+    auto check_low() -> void {
+        // note: common case is a read of a shared, rarely written cache line
+        // (14) paired with seq_cst (13)
+        if (atomic::load(&throttled_, atomic::SEQ_CST) != THROTTLE_ON) {
+            return;
+        }
+
+        auto const active = active_count();
+        if (active > low_) {
+            return;
+        }
+
+        lower(active);
+    }
+
+    // calls `on_low` if `high_` was reached
+    auto lower(u32 const active) -> void {
+        // note: the one that flips `throttled_` calls back
+        // note: acquire to follow `on_high`
+        auto expected = THROTTLE_ON;
+        if (!atomic::compare_exchange(&throttled_, &expected,
+                                      THROTTLE_LOWERING, false,
+                                      atomic::ACQUIRE, atomic::RELAXED)) {
+            return;
+        }
+        on_low_(active);
+
+        // note: release so a following `on_high` sees `on_low` effects
+        atomic::store(&throttled_, THROTTLE_OFF, atomic::RELEASE);
+    }
+
+    // returns true if `deadline` in `kernel::core::rdtsc` ticks has passed
+    // note: 0 has always passed
+    static auto expired(u64 const deadline) -> bool {
+        return deadline == 0 || kernel::core::rdtsc() >= deadline;
+    }
+
+    // called by consumer that claimed `entry`
+    // returns:
+    //   true if job is to be run
+    //   false if job was cancelled
+    static auto claim(Entry& entry) -> bool {
+        // note: `state` written by producer is visible through acquire on
+        //       `sequence`
+        if (atomic::load(&entry.state, atomic::RELAXED) == STATE_PLAIN) {
+            return true;
+        }
+
+        // races with `cancel`; whichever is first decides
+        auto const state =
+            atomic::exchange(&entry.state, STATE_PLAIN, atomic::RELAXED);
+        return (state & STATE_MASK) == STATE_PENDING;
+    }
+
+    // runs job in `entry`; if run by a core's consumer records its cost and
+    // resets the core's scratch arena
+    // note: `local` is the slot of the calling core or nullptr
+    auto call(Entry& entry, bool const run, Local const* const local)
+        -> Status {
+        if (local == nullptr || !run ||
+            (costs_ == nullptr && scratch_ == nullptr)) {
+            return entry.func(entry.data, run);
+        }
+
+        auto const core_index = u32(local - locals_);
+        auto const start = costs_ ? kernel::core::rdtsc() : 0;
+        auto const status = entry.func(entry.data, true);
+        if (costs_) {
+            costs_->record(core_index, ptr<void const>(uptr(entry.func)),
+                           kernel::core::rdtsc() - start);
+        }
+        if (scratch_) {
+            scratch_->reset(core_index);
+        }
+        return status;
+    }
+
+    // constructs job in `entry`
+    template <is_job T, typename... Args>
+    static auto prepare(Entry& entry, Args&&... args) -> void {
+        new (entry.data) T{fwd<Args>(args)...};
+        entry.func = &invoke<T>;
+    }
+
+    // runs the job if `run` is true, then destroys it unless not done
+    template <is_job T> static auto invoke(void* data, bool const run) -> Status {
+        auto* const p = ptr<T>(data);
+        if (run) {
+            if constexpr (is_resumable_job<T>) {
+                auto const status = p->run();
+                if (status != Status::Done) {
+                    // state is kept in the slot
+                    return status;
+                }
+            } else {
+                p->run();
+            }
+        }
+        p->~T();
+        return Status::Done;
+    }
+};
+
+//
+// multi-producer, multi-consumer earliest deadline first job queue
+//
+// each core keeps the jobs it adds in a pairing heap ordered by deadline;
+// consumers take the job with the earliest deadline of all cores, stealing it
+// from the other core's heap
+//
+// thread safety:
+//  * try_add(), add(): one producer thread per `kernel::core::index`
+//  * run_next(core_index): one consumer thread per core index
+//  * wait_idle(): any thread
+//  * active_count(): any thread
+//
+// constraints:
+//  * max job parameters size: 48 bytes
+//  * jobs per core: configurable through template argument
+//  * order across cores is approximate; a job added while a consumer chooses
+//    a heap may run after a job with later deadline
+//  * heaps are guarded by spin locks; an interrupt that adds jobs must not
+//    happen while its core runs `run_next`
+//
+template <u32 HeapSize = 32, u32 Cores = kernel::MAX_CORES> class Edf final {
+    // runs the job then destroys it
+    using Func = auto (*)(void* data) -> void;
+
+    // note: same as `Mpmc` so a job fits either queue
+    static auto constexpr JOB_SIZE =
+        kernel::core::CACHE_LINE_SIZE - sizeof(Func) - 2 * sizeof(u32);
+
+    // deadline of an empty heap
+    static auto constexpr NONE = ~0ull;
+
+    struct Node {
+        u8 data[JOB_SIZE];
+        Func func;
+        u64 deadline;
+        // first child in heap
+        Node* child;
+        // next sibling in heap or next in free list
+        Node* sibling;
+    };
+
+    struct alignas(kernel::core::CACHE_LINE_SIZE) Heap {
+        atomic::Spinlock lock;
+        // deadline of `root`, `NONE` if empty
+        // note: read without lock by consumers choosing a heap
+        u64 top;
+        Node* root;
+        Node* free;
+        Node nodes[HeapSize];
+    };
+
+    // owning core adds, any consumer takes
+    Heap heaps_[Cores];
+
+    // number of cores scanned by consumers, see `init`
+    // note: producers atomically raise, consumers atomically read
+    u32 core_count_;
+
+    // producers atomically write
+    alignas(kernel::core::CACHE_LINE_SIZE) u32 added_;
+
+    // consumers atomically write
+    alignas(kernel::core::CACHE_LINE_SIZE) u32 completed_;
+
+    // make sure `completed_` is alone on cache line
+    u8 padding[kernel::core::CACHE_LINE_SIZE - sizeof(completed_)];
+
+  public:
+    // called before any thread uses the queue
+    // note: `core_count` is the number of core indexes that add or run jobs;
+    //       a core beyond it that adds a job extends the count
+    auto init(u32 const core_count) -> void {
+        core_count_ = core_count;
+        added_ = 0;
+        completed_ = 0;
+        for (auto& heap : heaps_) {
+            heap.top = NONE;
+            heap.root = nullptr;
+            heap.free = nullptr;
+            for (auto& node : heap.nodes) {
+                node.sibling = heap.free;
+                heap.free = &node;
+            }
+        }
+    }
+
+    // adds job that should finish before `deadline` in `kernel::core::rdtsc`
+    // ticks to the calling core's heap
+    // returns:
+    //   true if job was added
+    //   false if the heap was full
+    template <is_job T, typename... Args>
+    auto try_add(u64 const deadline, Args&&... args) -> bool {
+        static_assert(sizeof(T) <= JOB_SIZE, "job too large for queue slot");
+        static_assert(!is_resumable_job<T>,
+                      "resumable jobs not supported by deadline queue");
+
+        auto const core_index = kernel::core::index();
+
+        // consumers scan the heaps below `core_count_`
+        auto count = atomic::load(&core_count_, atomic::RELAXED);
+        while (core_index >= count &&
+               !atomic::compare_exchange(&core_count_, &count, core_index + 1,
+                                         true, atomic::RELAXED,
+                                         atomic::RELAXED)) {
+        }
+
+        auto& heap = heaps_[core_index];
+        heap.lock.lock();
+
+        auto* const node = heap.free;
+        if (node == nullptr) {
+            heap.lock.unlock();
+            return false;
+        }
+        heap.free = node->sibling;
+
+        new (node->data) T{fwd<Args>(args)...};
+        node->func = [](void* data) {
+            auto* const p = ptr<T>(data);
+            p->run();
+            p->~T();
+        };
+        node->deadline = deadline;
+        node->child = nullptr;
+        node->sibling = nullptr;
+
+        // note: counted before visible to consumers so `active_count` does
+        //       not underflow
+        atomic::add(&added_, 1u, atomic::RELAXED);
+
+        heap.root = meld(heap.root, node);
+        atomic::store(&heap.top, heap.root->deadline, atomic::RELAXED);
+
+        heap.lock.unlock();
+        return true;
+    }
+
+    // adds job, spinning while the calling core's heap is full
+    template <is_job T, typename... Args>
+    auto add(u64 const deadline, Args&&... args) -> void {
+        while (!try_add<T>(deadline, fwd<Args>(args)...)) {
+            kernel::core::pause();
+        }
+    }
+
+    // called from the consumer on core `core_index`
+    // runs the job with the earliest deadline of all heaps, preferring the
+    // core's own heap on ties
+    // returns:
+    //   true if job was run
+    //   false if no job was run
+    auto run_next(u32 const core_index) -> bool {
+        auto best = core_index;
+        auto best_top = atomic::load(&heaps_[core_index].top, atomic::RELAXED);
+        auto const count = atomic::load(&core_count_, atomic::RELAXED);
+        for (auto i = 0u; i < count; ++i) {
+            auto const top = atomic::load(&heaps_[i].top, atomic::RELAXED);
+            if (top < best_top) {
+                best = i;
+                best_top = top;
+            }
+        }
+
+        if (best_top == NONE) {
+            return false;
+        }
+
+        auto& heap = heaps_[best];
+        heap.lock.lock();
+
+        auto* const node = heap.root;
+        if (node == nullptr) {
+            // taken by competing consumer
+            heap.lock.unlock();
+            return false;
+        }
+
+        heap.root = merge_pairs(node->child);
+        atomic::store(&heap.top, heap.root ? heap.root->deadline : NONE,
+                      atomic::RELAXED);
+
+        heap.lock.unlock();
+
+        // note: node is off the heap and not free; run outside the lock
+        node->func(node->data);
+
+        heap.lock.lock();
+        node->sibling = heap.free;
+        heap.free = node;
+        heap.lock.unlock();
+
+        // (1) paired with acquire (2)
+        atomic::add(&completed_, 1u, atomic::RELEASE);
+
+        return true;
+    }
+
     // intended to be used in status displays etc
     auto active_count() const -> u32 {
-        auto const head = atomic::load(&head_, atomic::RELAXED);
+        auto const added = atomic::load(&added_, atomic::RELAXED);
         auto const completed = atomic::load(&completed_, atomic::RELAXED);
-        return head - completed;
+        return added - completed;
     }
 
     // spin until all work is finished
     auto wait_idle() const -> void {
         while (true) {
-            auto const head = atomic::load(&head_, atomic::RELAXED);
-            // note: relaxed is safe; thread sees its own prior additions
+            auto const added = atomic::load(&added_, atomic::RELAXED);
 
-            // (6) paired with release (5)
+            // (2) paired with release (1)
             // note: acquire is required to see job memory side-effects
             auto const completed = atomic::load(&completed_, atomic::ACQUIRE);
 
-            if (head == completed) {
+            if (added == completed) {
                 return;
             }
 
             kernel::core::pause();
         }
     }
+
+  private:
+    // returns root of the heap melding heaps `a` and `b`
+    static auto meld(Node* const a, Node* const b) -> Node* {
+        if (a == nullptr) {
+            return b;
+        }
+        if (b == nullptr) {
+            return a;
+        }
+
+        auto* const root = b->deadline < a->deadline ? b : a;
+        auto* const other = root == a ? b : a;
+        other->sibling = root->child;
+        root->child = other;
+        return root;
+    }
+
+    // returns root of the heap melding the sibling list starting at `first`
+    // note: two-pass pairing, amortized O(log n)
+    static auto merge_pairs(Node* first) -> Node* {
+        // meld pairs left to right, collecting them in reverse
+        Node* pairs = nullptr;
+        while (first != nullptr) {
+            auto* const a = first;
+            auto* const b = a->sibling;
+            if (b == nullptr) {
+                a->sibling = pairs;
+                pairs = a;
+                break;
+            }
+            first = b->sibling;
+            a->sibling = nullptr;
+            b->sibling = nullptr;
+            auto* const pair = meld(a, b);
+            pair->sibling = pairs;
+            pairs = pair;
+        }
+
+        // meld the pairs right to left
+        Node* root = nullptr;
+        while (pairs != nullptr) {
+            auto* const next = pairs->sibling;
+            pairs->sibling = nullptr;
+            root = meld(root, pairs);
+            pairs = next;
+        }
+        return root;
+    }
 };
 
 } // namespace queue
 
 queue::Mpmc<256> inline jobs;
+queue::Edf<> inline deadlines;
+queue::Scratch inline scratch;
 
 } // namespace osca
@@ -0,0 +1,451 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "kernel.hpp"
+#include "types.hpp"
+
+//
+// physical page allocator
+//
+// buddy allocator over the usable regions of `kernel::memory_map` with a
+// per-core cache of single pages so the common case takes no shared lock
+//
+// idle cores zero pages ahead of time with `fill_zeroed` so that
+// `allocate_zeroed_page` does not zero on the allocation path
+//
+// usage:
+//   kernel implements `kernel::allocate_pages` with `pages::allocate_pages`
+//   after `pages::init` at start and lets idle consumers call
+//   `pages::fill_zeroed` through `Mpmc::set_idle`
+//
+// thread safety:
+//  * init(): once before any other call
+//  * allocate(), free(): any core
+//  * allocate_page(), free_page(), allocate_pages(), free_pages(), drain():
+//    any core; caches are indexed by `kernel::core::index`
+//  * fill_zeroed(), allocate_zeroed_page(): any core
+//  * available(), zeroed_available(): any core
+//
+// constraints:
+//  * physical addresses are identity mapped
+//  * largest block: 2^MAX_ORDER pages
+//  * must not be used from interrupt handlers (spin lock and per-core cache)
+//
+namespace kernel::pages {
+
+auto constexpr PAGE_SIZE = 4096ull;
+
+// largest block is 2^MAX_ORDER pages (4 MB)
+auto constexpr MAX_ORDER = 10u;
+
+// single pages cached per core
+auto constexpr CACHE_SIZE = 64u;
+
+// pages moved between a core's cache and the buddy at once
+auto constexpr CACHE_BATCH = CACHE_SIZE / 2;
+
+// uefi memory descriptor
+// note: entries in `memory_map` are `descriptor_size` apart which may be larger
+struct Descriptor {
+    u32 type;
+    u32 padding;
+    u64 physical_start;
+    u64 virtual_start;
+    u64 number_of_pages;
+    u64 attribute;
+};
+
+// uefi memory types that are free after exit of boot services
+auto constexpr BOOT_SERVICES_CODE = 3u;
+auto constexpr BOOT_SERVICES_DATA = 4u;
+auto constexpr CONVENTIONAL_MEMORY = 7u;
+
+// free block, stored in its first page
+struct Block {
+    Block* next;
+    Block* prev;
+};
+
+// bit in `Buddy::orders` marking the first page of a free block
+auto constexpr FREE = 0x80u;
+
+struct Buddy {
+    atomic::Spinlock lock;
+    // address of page 0, aligned to the largest block so that buddies of
+    // page indexes are buddies in memory
+    uptr base;
+    u64 page_count;
+    // per page: `FREE | order` for the first page of a free block, else 0
+    u8* orders;
+    // free blocks by order
+    Block* lists[MAX_ORDER + 1];
+    // pages in `lists`
+    u64 free_pages;
+};
+
+// note: guarded by `lock` except `free_pages` read by `available`
+Buddy inline buddy;
+
+// single pages of a core
+// note: only accessed by the owning core, no atomics needed
+struct alignas(core::CACHE_LINE_SIZE) Cache {
+    void* pages[CACHE_SIZE];
+    u32 count;
+};
+
+Cache inline caches[MAX_CORES];
+
+// zeroed pages kept for `allocate_zeroed_page`
+auto constexpr ZEROED_SIZE = 256u;
+
+// pages zeroed ahead of time by idle cores
+struct Zeroed {
+    atomic::Spinlock lock;
+    void* pages[ZEROED_SIZE];
+    u32 count;
+};
+
+// note: guarded by `lock` except `count` read by `fill_zeroed`
+Zeroed inline zeroed;
+
+// returns smallest order with at least `num_pages` pages
+auto inline order_of(u64 const num_pages) -> u32 {
+    auto order = 0u;
+    while ((1ull << order) < num_pages) {
+        ++order;
+    }
+    return order;
+}
+
+// adds free block at page `index` of `order` to its list
+// note: called with lock held
+auto inline push(u64 const index, u32 const order) -> void {
+    auto* const block = ptr<Block>(buddy.base + index * PAGE_SIZE);
+    block->prev = nullptr;
+    block->next = buddy.lists[order];
+    if (block->next) {
+        block->next->prev = block;
+    }
+    buddy.lists[order] = block;
+    buddy.orders[index] = u8(FREE | order);
+    atomic::store(&buddy.free_pages, buddy.free_pages + (1ull << order),
+                  atomic::RELAXED);
+}
+
+// removes free block at page `index` of `order` from its list
+// note: called with lock held
+auto inline remove(u64 const index, u32 const order) -> void {
+    auto* const block = ptr<Block>(buddy.base + index * PAGE_SIZE);
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        buddy.lists[order] = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+    buddy.orders[index] = 0;
+    atomic::store(&buddy.free_pages, buddy.free_pages - (1ull << order),
+                  atomic::RELAXED);
+}
+
+// returns block of `order` splitting a larger one if needed, nullptr if none
+// note: called with lock held
+auto inline take(u32 const order) -> void* {
+    auto k = order;
+    while (k <= MAX_ORDER && buddy.lists[k] == nullptr) {
+        ++k;
+    }
+    if (k > MAX_ORDER) {
+        return nullptr;
+    }
+
+    auto const index = (uptr(buddy.lists[k]) - buddy.base) / PAGE_SIZE;
+    remove(index, k);
+
+    // free the upper halves while splitting down to `order`
+    while (k > order) {
+        --k;
+        push(index + (1ull << k), k);
+    }
+
+    return ptr<void>(buddy.base + index * PAGE_SIZE);
+}
+
+// frees block at page `index` of `order` merging it with free buddies
+// note: called with lock held
+auto inline release(u64 index, u32 order) -> void {
+    while (order < MAX_ORDER) {
+        auto const other = index ^ (1ull << order);
+        if (other >= buddy.page_count ||
+            buddy.orders[other] != u8(FREE | order)) {
+            break;
+        }
+        remove(other, order);
+        index &= ~(1ull << order);
+        ++order;
+    }
+    push(index, order);
+}
+
+// frees pages of `start` to `end` as the largest aligned blocks
+// note: called with lock held
+auto inline release_range(uptr start, uptr const end) -> void {
+    while (start < end) {
+        auto const index = (start - buddy.base) / PAGE_SIZE;
+        auto order = 0u;
+        while (order < MAX_ORDER && (index & (1ull << order)) == 0 &&
+               start + (PAGE_SIZE << (order + 1)) <= end) {
+            ++order;
+        }
+        release(index, order);
+        start += PAGE_SIZE << order;
+    }
+}
+
+// calls `f(start, end)` for each usable region of `memory_map`
+template <typename F>
+auto inline for_each_region(bool const reclaim_boot_services, F f) -> void {
+    for (auto offset = 0ull;
+         offset + sizeof(Descriptor) <= memory_map.size;
+         offset += memory_map.descriptor_size) {
+        auto const* const d =
+            ptr_offset<Descriptor const>(memory_map.buffer, offset);
+        auto const usable = d->type == CONVENTIONAL_MEMORY ||
+                            (reclaim_boot_services &&
+                             (d->type == BOOT_SERVICES_CODE ||
+                              d->type == BOOT_SERVICES_DATA));
+        if (!usable || d->number_of_pages == 0) {
+            continue;
+        }
+
+        // note: page 0 is kept out so no block is a null pointer
+        auto const start =
+            d->physical_start == 0 ? PAGE_SIZE : d->physical_start;
+        auto const end = d->physical_start + d->number_of_pages * PAGE_SIZE;
+        if (start < end) {
+            f(uptr(start), uptr(end));
+        }
+    }
+}
+
+// builds the buddy from the usable regions of `memory_map`
+// note: boot services memory is usable only after exit of boot services and
+//       when page tables and stacks no longer live there
+// returns:
+//   true if pages are available
+//   false if no region fits the page orders table
+auto inline init(bool const reclaim_boot_services) -> bool {
+    // span of usable memory
+    auto low = ~uptr(0);
+    auto high = uptr(0);
+    for_each_region(reclaim_boot_services, [&](uptr const start,
+                                               uptr const end) {
+        low = start < low ? start : low;
+        high = end > high ? end : high;
+    });
+    if (low >= high) {
+        return false;
+    }
+
+    buddy.base = low & ~((PAGE_SIZE << MAX_ORDER) - 1);
+    buddy.page_count = (high - buddy.base) / PAGE_SIZE;
+    for (auto& list : buddy.lists) {
+        list = nullptr;
+    }
+    buddy.free_pages = 0;
+
+    // the orders table takes the start of the first region it fits in
+    auto const table_size =
+        (buddy.page_count + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    auto table = uptr(0);
+    for_each_region(reclaim_boot_services, [&](uptr const start,
+                                               uptr const end) {
+        if (table == 0 && end - start >= table_size) {
+            table = start;
+        }
+    });
+    if (table == 0) {
+        return false;
+    }
+
+    buddy.orders = ptr<u8>(table);
+    memset(buddy.orders, 0, buddy.page_count);
+
+    for_each_region(reclaim_boot_services, [&](uptr start, uptr const end) {
+        if (start == table) {
+            start += table_size;
+        }
+        release_range(start, end);
+    });
+
+    for (auto& cache : caches) {
+        cache.count = 0;
+    }
+    zeroed.count = 0;
+
+    return buddy.free_pages != 0;
+}
+
+// returns block of 2^order pages, nullptr if none
+auto inline allocate(u32 const order) -> void* {
+    if (order > MAX_ORDER) {
+        return nullptr;
+    }
+
+    buddy.lock.lock();
+    auto* const block = take(order);
+    buddy.lock.unlock();
+    return block;
+}
+
+// frees block of 2^order pages returned by `allocate`
+auto inline free(void* const block, u32 const order) -> void {
+    buddy.lock.lock();
+    release((uptr(block) - buddy.base) / PAGE_SIZE, order);
+    buddy.lock.unlock();
+}
+
+// returns page from the calling core's cache, nullptr if none
+auto inline allocate_page() -> void* {
+    auto& cache = caches[core::index()];
+    if (cache.count == 0) {
+        // refill half the cache under one lock
+        buddy.lock.lock();
+        while (cache.count < CACHE_BATCH) {
+            auto* const page = take(0);
+            if (page == nullptr) {
+                break;
+            }
+            cache.pages[cache.count++] = page;
+        }
+        buddy.lock.unlock();
+
+        if (cache.count == 0) {
+            return nullptr;
+        }
+    }
+
+    return cache.pages[--cache.count];
+}
+
+// frees page to the calling core's cache
+// note: page may have been allocated on another core
+auto inline free_page(void* const page) -> void {
+    auto& cache = caches[core::index()];
+    if (cache.count == CACHE_SIZE) {
+        // return half the cache under one lock
+        buddy.lock.lock();
+        while (cache.count > CACHE_SIZE - CACHE_BATCH) {
+            release((uptr(cache.pages[--cache.count]) - buddy.base) /
+                        PAGE_SIZE,
+                    0);
+        }
+        buddy.lock.unlock();
+    }
+
+    cache.pages[cache.count++] = page;
+}
+
+// returns `num_pages` contiguous pages rounded up to a power of 2, nullptr if
+// none
+auto inline allocate_pages(u64 const num_pages) -> void* {
+    if (num_pages <= 1) {
+        return allocate_page();
+    }
+    return allocate(order_of(num_pages));
+}
+
+// frees pages returned by `allocate_pages` with the same `num_pages`
+auto inline free_pages(void* const pages, u64 const num_pages) -> void {
+    if (num_pages <= 1) {
+        free_page(pages);
+        return;
+    }
+    free(pages, order_of(num_pages));
+}
+
+// returns the calling core's cached pages to the buddy
+auto inline drain() -> void {
+    auto& cache = caches[core::index()];
+    buddy.lock.lock();
+    while (cache.count > 0) {
+        release((uptr(cache.pages[--cache.count]) - buddy.base) / PAGE_SIZE,
+                0);
+    }
+    buddy.lock.unlock();
+}
+
+// zeroes `page` with non-temporal stores that bypass the caches
+auto inline zero_page(void* const page) -> void {
+    memory::zero(page, PAGE_SIZE);
+}
+
+// called from an idle core, for example through `Mpmc::set_idle`
+// zeroes one page from the calling core's cache into the zeroed pages
+// returns:
+//   true if a page was added
+//   false if zeroed pages are full or no pages are free
+auto inline fill_zeroed() -> bool {
+    if (atomic::load(&zeroed.count, atomic::RELAXED) >= ZEROED_SIZE) {
+        return false;
+    }
+
+    auto* const page = allocate_page();
+    if (page == nullptr) {
+        return false;
+    }
+    zero_page(page);
+
+    zeroed.lock.lock();
+    auto const count = zeroed.count;
+    if (count < ZEROED_SIZE) {
+        zeroed.pages[count] = page;
+        atomic::store(&zeroed.count, count + 1, atomic::RELAXED);
+    }
+    zeroed.lock.unlock();
+
+    if (count >= ZEROED_SIZE) {
+        // filled by another core meanwhile
+        free_page(page);
+        return false;
+    }
+    return true;
+}
+
+// returns zeroed page, zeroing one now if none is ready; nullptr if none
+auto inline allocate_zeroed_page() -> void* {
+    void* page = nullptr;
+    if (atomic::load(&zeroed.count, atomic::RELAXED) != 0) {
+        zeroed.lock.lock();
+        auto const count = zeroed.count;
+        if (count != 0) {
+            page = zeroed.pages[count - 1];
+            atomic::store(&zeroed.count, count - 1, atomic::RELAXED);
+        }
+        zeroed.lock.unlock();
+    }
+    if (page) {
+        return page;
+    }
+
+    page = allocate_page();
+    if (page) {
+        memset(page, 0, PAGE_SIZE);
+    }
+    return page;
+}
+
+// returns number of zeroed pages ready
+// note: intended to be used in status displays etc
+auto inline zeroed_available() -> u32 {
+    return atomic::load(&zeroed.count, atomic::RELAXED);
+}
+
+// returns number of free pages in the buddy, not counting core caches
+// note: intended to be used in status displays etc
+auto inline available() -> u64 {
+    return atomic::load(&buddy.free_pages, atomic::RELAXED);
+}
+
+} // namespace kernel::pages
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "kernel.hpp"
+#include "osca.hpp"
+#include "types.hpp"
+
+//
+// bulk memory operations split across cores through a job queue
+//
+// the region is cut at `PARALLEL_CHUNK` boundaries of the destination; pieces
+// are added to the queue, the caller runs the last piece and then helps run
+// jobs until all pieces are done
+//
+// below `PARALLEL_THRESHOLD` bytes the caller does the whole operation
+//
+// thread safety:
+//  * parallel_memset(), parallel_memcpy(): any thread that may add jobs to
+//    the queue, including jobs
+//
+// constraints:
+//  * regions of `parallel_memcpy` must not overlap
+//  * not from interrupt handlers
+//
+namespace osca {
+
+// bytes per piece, page aligned in the destination
+auto constexpr PARALLEL_CHUNK = 256ull * 1024;
+
+// below, splitting costs more than it gains
+auto constexpr PARALLEL_THRESHOLD = 2 * PARALLEL_CHUNK;
+
+namespace parallel {
+
+// pieces of an operation not yet done
+// note: decremented by the jobs, the caller waits for 0
+struct Pending {
+    u32 count;
+};
+
+// fills a piece
+struct Fill {
+    u8* dest;
+    u64 size;
+    Pending* pending;
+    u8 c;
+    // true if the whole region is large enough to bypass the caches
+    bool streaming;
+
+    auto run() -> void {
+        // note: streaming needs at least 64 bytes
+        if (streaming && size >= 64) {
+            kernel::memory::fill_streaming(dest, u64(c) * 0x0101010101010101ull,
+                                           size);
+        } else {
+            kernel::memory::fill(dest, c, size);
+        }
+        // (1) paired with acquire (2)
+        atomic::add(&pending->count, u32(-1), atomic::RELEASE);
+    }
+};
+
+// copies a piece
+struct Copy {
+    u8* dest;
+    u8 const* src;
+    u64 size;
+    Pending* pending;
+    // true if the whole region is large enough to bypass the caches
+    bool streaming;
+
+    auto run() -> void {
+        // note: streaming needs at least 64 bytes
+        if (streaming && size >= 64) {
+            kernel::memory::copy_streaming(dest, src, size);
+        } else {
+            kernel::memory::copy(dest, src, size);
+        }
+        // (1) paired with acquire (2)
+        atomic::add(&pending->count, u32(-1), atomic::RELEASE);
+    }
+};
+
+// splits `n` bytes at `dest` into pieces, runs them and waits
+// note: `make(offset, size)` returns the job of a piece
+template <typename Job, typename Queue, typename Make>
+auto inline split(Queue& queue, u8* const dest, u64 const n, Pending& pending,
+                  Make const make) -> void {
+    // first piece ends at a chunk boundary of the destination
+    auto const first = PARALLEL_CHUNK - (uptr(dest) & (PARALLEL_CHUNK - 1));
+    pending.count = u32((n - first + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK + 1);
+
+    auto offset = 0ull;
+    auto size = first;
+    while (offset + size < n) {
+        auto job = make(offset, size);
+        // note: run in place if the queue is full
+        if (!queue.template try_add<Job>(job)) {
+            job.run();
+        }
+        offset += size;
+        size = PARALLEL_CHUNK;
+    }
+
+    // last piece on the calling core
+    make(offset, n - offset).run();
+
+    // help run jobs until all pieces are done
+    // (2) paired with release (1)
+    while (atomic::load(&pending.count, atomic::ACQUIRE)) {
+        if (!queue.run_next()) {
+            kernel::core::pause();
+        }
+    }
+}
+
+} // namespace parallel
+
+// fills `n` bytes at `dest` with `c` using idle cores of `queue`
+template <typename Queue = decltype(jobs)>
+auto inline parallel_memset(void* const dest, u8 const c, u64 const n,
+                            Queue& queue = jobs) -> void* {
+    if (n < PARALLEL_THRESHOLD) {
+        return kernel::memory::fill(dest, c, n);
+    }
+
+    auto* const d = ptr<u8>(dest);
+    auto const streaming = n > kernel::memory::STREAMING_THRESHOLD;
+    parallel::Pending pending;
+    parallel::split<parallel::Fill>(
+        queue, d, n, pending, [&](u64 const offset, u64 const size) {
+            return parallel::Fill{d + offset, size, &pending, c, streaming};
+        });
+    return dest;
+}
+
+// copies `n` bytes from `src` to `dest` using idle cores of `queue`
+template <typename Queue = decltype(jobs)>
+auto inline parallel_memcpy(void* const dest, void const* const src,
+                            u64 const n, Queue& queue = jobs) -> void* {
+    if (n < PARALLEL_THRESHOLD) {
+        return kernel::memory::copy(dest, src, n);
+    }
+
+    auto* const d = ptr<u8>(dest);
+    auto const* const s = ptr<u8>(src);
+    auto const streaming = n > kernel::memory::STREAMING_THRESHOLD;
+    parallel::Pending pending;
+    parallel::split<parallel::Copy>(
+        queue, d, n, pending, [&](u64 const offset, u64 const size) {
+            return parallel::Copy{d + offset, s + offset, size, &pending,
+                                  streaming};
+        });
+    return dest;
+}
+
+} // namespace osca
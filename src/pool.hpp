@@ -0,0 +1,173 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "kernel.hpp"
+#include "types.hpp"
+
+namespace osca {
+
+//
+// fixed-capacity object pool for job payloads larger than a queue slot
+//
+// each core takes objects from its own free list; an object freed on another
+// core is pushed to the owning core's lock-free remote list which the owner
+// collects when its local list runs dry; objects never used are handed out
+// from a shared bump index and belong to the core that first took them
+//
+// `try_add` and `add` pair the pool with a queue: the payload is created on
+// the calling core and the queue gets a slot-sized job referencing it that
+// runs the payload and returns it to the pool
+//
+// usage:
+//   osca::Pool<Payload> inline payloads;
+//   producer:
+//     payloads.add(osca::jobs, args...);
+//
+// thread safety:
+//  * init(): once before any other call
+//  * create(), destroy(): any core; lists are indexed by
+//    `kernel::core::index`
+//  * try_add(), add(): as the queue's `try_add`
+//
+// constraints:
+//  * `T` has `void run()`
+//  * at most `Capacity` objects alive
+//  * must not be used from interrupt handlers (per-core state)
+//
+template <typename T, u32 Capacity = 1024, u32 Cores = kernel::MAX_CORES>
+class Pool final {
+    struct alignas(kernel::core::CACHE_LINE_SIZE) Node {
+        Node* next;
+        // core that took the node from `fresh_`
+        u32 owner;
+        alignas(T) u8 object[sizeof(T)];
+    };
+
+    struct alignas(kernel::core::CACHE_LINE_SIZE) Cache {
+        // note: only accessed by the owning core
+        Node* local;
+
+        // objects freed by other cores
+        // note: other cores push, owner takes all
+        alignas(kernel::core::CACHE_LINE_SIZE) Node* remote;
+    };
+
+    Node nodes_[Capacity];
+    Cache caches_[Cores];
+
+    // nodes from index are unused
+    alignas(kernel::core::CACHE_LINE_SIZE) u32 fresh_;
+
+    // make sure `fresh_` is alone on cache line
+    u8 padding[kernel::core::CACHE_LINE_SIZE - sizeof(fresh_)];
+
+  public:
+    // job placed in the queue slot
+    struct Job {
+        Pool* pool;
+        T* object;
+
+        auto run() -> void {
+            object->run();
+            pool->destroy(object);
+        }
+    };
+
+    // called before use
+    auto init() -> void {
+        for (auto& cache : caches_) {
+            cache.local = nullptr;
+            cache.remote = nullptr;
+        }
+        fresh_ = 0;
+    }
+
+    // called from any core
+    // returns:
+    //   object constructed from `args`, nullptr if pool exhausted
+    template <typename... Args> auto create(Args&&... args) -> T* {
+        auto const core_index = kernel::core::index();
+        auto& cache = caches_[core_index];
+
+        if (cache.local == nullptr &&
+            atomic::load(&cache.remote, atomic::RELAXED)) {
+            // (2) paired with release (1)
+            cache.local =
+                atomic::exchange<Node*>(&cache.remote, nullptr, atomic::ACQUIRE);
+        }
+
+        auto* node = cache.local;
+        if (node) {
+            cache.local = node->next;
+        } else {
+            // note: relaxed because unused nodes carry no data
+            if (atomic::load(&fresh_, atomic::RELAXED) >= Capacity) {
+                return nullptr;
+            }
+            auto const index = atomic::add(&fresh_, 1u, atomic::RELAXED);
+            if (index >= Capacity) {
+                return nullptr;
+            }
+            node = &nodes_[index];
+            node->owner = core_index;
+        }
+
+        return new (node->object) T{fwd<Args>(args)...};
+    }
+
+    // called from any core
+    // destroys object from `create` and returns it to its owning core
+    auto destroy(T* const object) -> void {
+        object->~T();
+
+        auto* const node =
+            ptr<Node>(uptr(object) - __builtin_offsetof(Node, object));
+        auto& cache = caches_[node->owner];
+        if (node->owner == kernel::core::index()) {
+            node->next = cache.local;
+            cache.local = node;
+            return;
+        }
+
+        auto head = atomic::load(&cache.remote, atomic::RELAXED);
+        do {
+            node->next = head;
+            // (1) paired with acquire (2)
+        } while (!atomic::compare_exchange(&cache.remote, &head, node, true,
+                                           atomic::RELEASE, atomic::RELAXED));
+    }
+
+    // creates object from `args` and adds a job running it to `queue`
+    // returns:
+    //   false if pool exhausted or queue full
+    template <typename Queue, typename... Args>
+    auto try_add(Queue& queue, Args&&... args) -> bool {
+        auto* const object = create(fwd<Args>(args)...);
+        if (object == nullptr) {
+            return false;
+        }
+        if (!queue.template try_add<Job>(this, object)) {
+            destroy(object);
+            return false;
+        }
+        return true;
+    }
+
+    // blocks while pool is exhausted or queue is full
+    // note: the object is created once; `args` are not used after a failed
+    //       `create` since it fails before constructing
+    template <typename Queue, typename... Args>
+    auto add(Queue& queue, Args&&... args) -> void {
+        auto* object = create(fwd<Args>(args)...);
+        while (object == nullptr) {
+            kernel::core::pause();
+            object = create(fwd<Args>(args)...);
+        }
+
+        while (!queue.template try_add<Job>(this, object)) {
+            kernel::core::pause();
+        }
+    }
+};
+
+} // namespace osca
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "graphics.hpp"
+#include "kernel.hpp"
+#include "osca.hpp"
+#include "types.hpp"
+
+//
+// frame rendered in tiles across cores through a job queue
+//
+// drawing commands of a frame are recorded, then `render` cuts the back
+// buffer into `TILE_SIZE` square tiles that stay in the cache while all
+// commands touching them are drawn, found through the commands binned to
+// each row of tiles; jobs added to the queue and the caller claim tiles until
+// none are left, and the caller marks the drawn rectangles dirty once all are
+// done so the frame is presented together
+//
+// usage:
+//   renderer.begin();
+//   renderer.fill({0, 0, width, height}, background);
+//   renderer.blend({x, y, x + 200, y + 100}, 0x80ffffff);
+//   renderer.render(kernel::graphics::back_buffer);
+//   kernel::graphics::back_buffer.present(kernel::frame_buffer);
+//
+// thread safety:
+//  * begin(), fill(), blend(), render(): one thread at a time that may add
+//    jobs to the queue
+//
+// constraints:
+//  * at most `MAX_COMMANDS` commands per frame
+//  * `render` adds at most one job per core besides the caller to the queue
+//  * not from interrupt handlers
+//
+namespace osca {
+
+// pixels of a tile side: 64 x 64 x 4 bytes = 16 KB
+auto constexpr TILE_SIZE = 64u;
+
+auto constexpr MAX_COMMANDS = 4096u;
+
+// rows of tiles binned, 8192 pixels high
+auto constexpr MAX_TILE_ROWS = 128u;
+
+// commands binned to rows of tiles, a command once per row it touches
+auto constexpr MAX_BINNED = 4 * MAX_COMMANDS;
+
+namespace render {
+
+enum class Op : u8 { Fill, Blend };
+
+struct Command {
+    kernel::graphics::Rect rect;
+    u32 color;
+    Op op;
+};
+
+} // namespace render
+
+class Renderer final {
+    render::Command commands_[MAX_COMMANDS];
+    u32 count_;
+
+    // commands touching tile row r in order are
+    // `binned_[row_starts_[r]]` to `binned_[row_starts_[r + 1]]`
+    // note: when false every tile goes through all commands
+    bool binned_rows_;
+    u32 row_starts_[MAX_TILE_ROWS + 1];
+    u16 binned_[MAX_BINNED];
+
+    // frame being rendered
+    kernel::FrameBuffer target_;
+    u32 columns_;
+    u32 tiles_;
+    // next tile to claim
+    u32 next_;
+    // jobs not done
+    u32 pending_;
+
+    // claims tiles until none are left
+    struct Job {
+        Renderer* renderer;
+
+        auto run() -> void {
+            renderer->run_tiles();
+            // (1) paired with acquire (2)
+            atomic::add(&renderer->pending_, u32(-1), atomic::RELEASE);
+        }
+    };
+
+  public:
+    // starts recording the commands of a frame
+    auto begin() -> void { count_ = 0; }
+
+    // records a fill of `rect` with `color`
+    // returns:
+    //   false if the frame has `MAX_COMMANDS` commands
+    auto fill(kernel::graphics::Rect const rect, u32 const color) -> bool {
+        return record({rect, color, render::Op::Fill});
+    }
+
+    // records a blend of `color` with alpha in its top byte over `rect`
+    // returns:
+    //   false if the frame has `MAX_COMMANDS` commands
+    auto blend(kernel::graphics::Rect const rect, u32 const color) -> bool {
+        return record({rect, color, render::Op::Blend});
+    }
+
+    // returns number of recorded commands
+    auto count() const -> u32 { return count_; }
+
+    // draws the recorded commands to `back` using idle cores of `queue` and
+    // marks them dirty
+    // note: `cores` is the number of cores running jobs of `queue`, the
+    //       caller included; a helper job is added per other core, not per
+    //       tile, as each helper claims tiles until none are left and more
+    //       would only crowd the shared queue
+    template <typename Queue = decltype(jobs)>
+    auto render(kernel::graphics::BackBuffer& back, Queue& queue = jobs,
+                u32 const cores = kernel::core_count) -> void {
+        target_ = back.surface();
+        columns_ = (target_.width + TILE_SIZE - 1) / TILE_SIZE;
+        auto const rows = (target_.height + TILE_SIZE - 1) / TILE_SIZE;
+        tiles_ = columns_ * rows;
+        next_ = 0;
+        bin(rows);
+        pending_ = 0;
+
+        // a helper per core besides the caller, at most one per other tile
+        // and fewer if the queue is full
+        auto helpers = cores > 1 ? cores - 1 : 0u;
+        if (helpers >= tiles_) {
+            helpers = tiles_ > 0 ? tiles_ - 1 : 0u;
+        }
+        for (auto i = 0u; i < helpers; ++i) {
+            atomic::add(&pending_, 1u, atomic::RELAXED);
+            if (!queue.template try_add<Job>(Job{this})) {
+                atomic::add(&pending_, u32(-1), atomic::RELAXED);
+                break;
+            }
+        }
+
+        run_tiles();
+
+        // help run jobs until all helpers are done
+        // (2) paired with release (1)
+        while (atomic::load(&pending_, atomic::ACQUIRE)) {
+            if (!queue.run_next()) {
+                kernel::core::pause();
+            }
+        }
+
+        for (auto i = 0u; i < count_; ++i) {
+            back.mark(commands_[i].rect);
+        }
+    }
+
+  private:
+    auto record(render::Command const& command) -> bool {
+        if (count_ == MAX_COMMANDS) {
+            return false;
+        }
+        commands_[count_++] = command;
+        return true;
+    }
+
+    // sorts the commands into the `rows` rows of tiles they touch so that a
+    // tile goes through the commands of its row only
+    auto bin(u32 const rows) -> void {
+        binned_rows_ = false;
+        if (rows > MAX_TILE_ROWS) {
+            return;
+        }
+
+        // rows of tiles a command touches
+        auto const first_row = [](render::Command const& command) {
+            return command.rect.top / TILE_SIZE;
+        };
+        auto const end_row = [rows](render::Command const& command) {
+            auto const end = (command.rect.bottom + TILE_SIZE - 1) / TILE_SIZE;
+            return end < rows ? end : rows;
+        };
+
+        // count per row, then starts from the counts
+        for (auto r = 0u; r <= rows; ++r) {
+            row_starts_[r] = 0;
+        }
+        auto total = 0u;
+        for (auto i = 0u; i < count_; ++i) {
+            auto const& command = commands_[i];
+            if (command.rect.empty()) {
+                continue;
+            }
+            for (auto r = first_row(command); r < end_row(command); ++r) {
+                ++row_starts_[r + 1];
+                ++total;
+            }
+        }
+        if (total > MAX_BINNED) {
+            return;
+        }
+        for (auto r = 0u; r < rows; ++r) {
+            row_starts_[r + 1] += row_starts_[r];
+        }
+
+        // fill in order, advancing starts to the next row's start
+        for (auto i = 0u; i < count_; ++i) {
+            auto const& command = commands_[i];
+            if (command.rect.empty()) {
+                continue;
+            }
+            for (auto r = first_row(command); r < end_row(command); ++r) {
+                binned_[row_starts_[r]++] = u16(i);
+            }
+        }
+        // shift starts back by one row
+        for (auto r = rows; r > 0; --r) {
+            row_starts_[r] = row_starts_[r - 1];
+        }
+        row_starts_[0] = 0;
+        binned_rows_ = true;
+    }
+
+    // draws command `command` clipped to `tile`
+    auto draw(render::Command const& command,
+              kernel::graphics::Rect const tile) -> void {
+        auto const rect = kernel::graphics::intersect(command.rect, tile);
+        if (rect.empty()) {
+            return;
+        }
+        if (command.op == render::Op::Fill) {
+            kernel::graphics::fill_rect(target_, rect, command.color);
+        } else {
+            kernel::graphics::blend_rect(target_, rect, command.color);
+        }
+    }
+
+    // draws the commands touching tile `index` in order
+    auto draw_tile(u32 const index) -> void {
+        auto const row = index / columns_;
+        auto const left = (index % columns_) * TILE_SIZE;
+        auto const top = row * TILE_SIZE;
+        auto const tile = kernel::graphics::Rect{left, top, left + TILE_SIZE,
+                                                 top + TILE_SIZE};
+
+        if (!binned_rows_) {
+            for (auto i = 0u; i < count_; ++i) {
+                draw(commands_[i], tile);
+            }
+            return;
+        }
+        for (auto i = row_starts_[row]; i < row_starts_[row + 1]; ++i) {
+            draw(commands_[binned_[i]], tile);
+        }
+    }
+
+    auto run_tiles() -> void {
+        while (true) {
+            auto const index = atomic::add(&next_, 1u, atomic::RELAXED);
+            if (index >= tiles_) {
+                return;
+            }
+            draw_tile(index);
+        }
+    }
+};
+
+Renderer inline renderer;
+
+} // namespace osca
@@ -0,0 +1,554 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "coroutine.hpp"
+#include "kernel.hpp"
+#include "osca.hpp"
+#include "types.hpp"
+
+//
+// coroutine frame pool
+//
+// frames are carved from a static arena and recycled in per-core free lists
+// by size class; frames beyond a core's limit go to a list shared by all cores
+// so frames freed by consumers reach the producer that allocates them
+//
+// thread safety:
+//  * allocate(), free(): any core; lists are indexed by `kernel::core::index`
+//
+// constraints:
+//  * frame size: at most 1024 bytes
+//  * total frames: bounded by the 1 MB arena
+//  * must not be used from interrupt handlers
+//
+namespace osca::frames {
+
+// size classes are 128, 256, 512 and 1024 bytes
+auto constexpr MIN_SIZE = 128u;
+auto constexpr CLASS_COUNT = 4u;
+auto constexpr ARENA_SIZE = 1024u * 1024;
+
+// frames kept per core and size class before sharing
+auto constexpr CACHE_LIMIT = 32u;
+
+struct Free {
+    Free* next;
+    // next in shared list as in `shared`
+    u32 next_shared;
+};
+
+// free lists of a core
+struct alignas(kernel::core::CACHE_LINE_SIZE) Cache {
+    Free* lists[CLASS_COUNT];
+    u32 counts[CLASS_COUNT];
+};
+
+Cache inline caches[kernel::MAX_CORES];
+
+alignas(kernel::core::CACHE_LINE_SIZE) u8 inline arena[ARENA_SIZE];
+
+// bytes of `arena` handed out
+alignas(kernel::core::CACHE_LINE_SIZE) u32 inline arena_used;
+
+// lock-free lists of frames shared by all cores
+// note: low half is offset in `arena` divided by `MIN_SIZE` plus 1, 0 if
+//       empty; high half is a tag incremented on every change to detect a
+//       list changed between load and compare exchange (aba)
+alignas(kernel::core::CACHE_LINE_SIZE) u64 inline shared[CLASS_COUNT];
+
+// returns:
+//   size class of `size`, `CLASS_COUNT` if too large
+auto inline size_class(usize const size) -> u32 {
+    auto cls = 0u;
+    while (cls < CLASS_COUNT && (MIN_SIZE << cls) < size) {
+        ++cls;
+    }
+    return cls;
+}
+
+// returns:
+//   frame from shared list of size class `cls`, nullptr if empty
+auto inline pop_shared(u32 const cls) -> void* {
+    // (2) paired with release (1)
+    auto head = atomic::load(&shared[cls], atomic::ACQUIRE);
+    while (true) {
+        auto const index = u32(head);
+        if (index == 0) {
+            return nullptr;
+        }
+
+        auto* const frame = ptr<Free>(&arena[(index - 1) * MIN_SIZE]);
+        // note: frame may be popped and reused concurrently in which case the
+        //       tag fails the compare exchange
+        auto const next = atomic::load(&frame->next_shared, atomic::RELAXED);
+        auto const desired = (((head >> 32) + 1) << 32) | next;
+        if (atomic::compare_exchange(&shared[cls], &head, desired, true,
+                                     atomic::ACQUIRE, atomic::ACQUIRE)) {
+            return frame;
+        }
+    }
+}
+
+// pushes `frame` to shared list of size class `cls`
+auto inline push_shared(u32 const cls, void* const frame) -> void {
+    auto const index = u32((ptr<u8>(frame) - arena) / MIN_SIZE) + 1;
+    auto* const f = ptr<Free>(frame);
+    auto head = atomic::load(&shared[cls], atomic::RELAXED);
+    while (true) {
+        atomic::store(&f->next_shared, u32(head), atomic::RELAXED);
+        auto const desired = (((head >> 32) + 1) << 32) | index;
+        // (1) paired with acquire (2)
+        if (atomic::compare_exchange(&shared[cls], &head, desired, true,
+                                     atomic::RELEASE, atomic::RELAXED)) {
+            return;
+        }
+    }
+}
+
+// returns:
+//   frame of at least `size` bytes, nullptr if too large or arena exhausted
+auto inline allocate(usize const size) -> void* {
+    auto const cls = size_class(size);
+    if (cls == CLASS_COUNT) {
+        return nullptr;
+    }
+
+    auto& cache = caches[kernel::core::index()];
+    if (cache.lists[cls]) {
+        auto* const frame = cache.lists[cls];
+        cache.lists[cls] = frame->next;
+        --cache.counts[cls];
+        return frame;
+    }
+
+    if (auto* const frame = pop_shared(cls)) {
+        return frame;
+    }
+
+    auto const bytes = MIN_SIZE << cls;
+    auto const offset = atomic::add(&arena_used, bytes, atomic::RELAXED);
+    if (offset + bytes > ARENA_SIZE) {
+        // note: `arena_used` stays past the end; later calls fail as well
+        return nullptr;
+    }
+
+    return &arena[offset];
+}
+
+// returns frame allocated with `size` to the calling core's free list
+// note: frame may have been allocated on another core
+auto inline free(void* const frame, usize const size) -> void {
+    auto const cls = size_class(size);
+    auto& cache = caches[kernel::core::index()];
+    if (cache.counts[cls] == CACHE_LIMIT) {
+        push_shared(cls, frame);
+        return;
+    }
+
+    auto* const f = ptr<Free>(frame);
+    f->next = cache.lists[cls];
+    cache.lists[cls] = f;
+    ++cache.counts[cls];
+}
+
+} // namespace osca::frames
+
+namespace osca {
+
+// job that resumes a suspended coroutine
+// note: a coroutine that awaits a condition while run by this job hands the
+//       condition to the job which is then requeued until it is satisfied
+struct Resume {
+    std::coroutine_handle<> handle;
+    // returns true when `condition` is satisfied, nullptr if none
+    auto (*ready)(void const* condition) -> bool = nullptr;
+    alignas(8) u8 condition[24] = {};
+
+    auto run() -> queue::Status;
+};
+
+// the `Resume` job resuming a coroutine on each core, nullptr if none
+struct alignas(kernel::core::CACHE_LINE_SIZE) Resuming {
+    Resume* job;
+};
+
+Resuming inline resuming[kernel::MAX_CORES];
+
+auto inline Resume::run() -> queue::Status {
+    if (ready) {
+        if (!ready(condition)) {
+            return queue::Status::Requeue;
+        }
+        ready = nullptr;
+    }
+
+    // note: saved because a job may run other jobs
+    auto& current = resuming[kernel::core::index()].job;
+    auto* const previous = current;
+    current = this;
+    handle.resume();
+    current = previous;
+
+    return ready ? queue::Status::Requeue : queue::Status::Done;
+}
+
+// resumes `handle` from the queue, on this core next if possible
+// note: resumes inline if the queue is full
+auto inline resume_later(std::coroutine_handle<> const handle) -> void {
+    if (!jobs.try_add_local<Resume>(handle)) {
+        handle.resume();
+    }
+}
+
+// awaitable that suspends until `Ready` is satisfied
+template <typename Ready> struct Until {
+    static_assert(sizeof(Ready) <= sizeof(Resume::condition) &&
+                      __is_trivially_copyable(Ready),
+                  "condition too large for job");
+
+    Ready ready;
+
+    auto await_ready() -> bool { return ready(); }
+
+    auto await_suspend(std::coroutine_handle<> const handle) -> bool {
+        auto* const job = resuming[kernel::core::index()].job;
+        if (job != nullptr && job->ready == nullptr) {
+            // requeue the job running this coroutine until ready
+            job->handle = handle;
+            new (job->condition) Ready{ready};
+            job->ready = [](void const* const condition) -> bool {
+                return (*ptr<Ready>(condition))();
+            };
+            return true;
+        }
+
+        // not run by a `Resume` job; help run jobs until ready
+        while (!ready()) {
+            if (!jobs.run_next()) {
+                kernel::core::pause();
+            }
+        }
+        return false;
+    }
+
+    auto await_resume() -> void {}
+};
+
+// `co_await schedule()` continues the coroutine from the queue after the jobs
+// waiting in it
+auto inline schedule() {
+    struct Ready {
+        auto operator()() const -> bool { return true; }
+    };
+
+    struct Awaiter : Until<Ready> {
+        auto await_ready() -> bool { return false; }
+    };
+
+    return Awaiter{};
+}
+
+// `co_await sleep_for(ticks)` continues the coroutine after `ticks` of
+// `kernel::core::rdtsc`
+auto inline sleep_for(u64 const ticks) {
+    struct Ready {
+        u64 deadline;
+
+        auto operator()() const -> bool {
+            return kernel::core::rdtsc() >= deadline;
+        }
+    };
+
+    return Until<Ready>{{kernel::core::rdtsc() + ticks}};
+}
+
+// `co_await wait_until(ticket)` continues the coroutine when the job with
+// `ticket` in `osca::jobs` and all jobs added before it have finished
+auto inline wait_until(u32 const ticket) {
+    struct Ready {
+        u32 ticket;
+
+        auto operator()() const -> bool { return jobs.done(ticket); }
+    };
+
+    return Until<Ready>{{ticket}};
+}
+
+//
+// group of jobs that can be awaited by a coroutine
+//
+// thread safety:
+//  * try_add(), add(): any thread
+//  * co_await: any coroutine
+//
+class Group final {
+    u32 pending_ = 0;
+
+    // job of the group
+    // note: group is first to allow aggregate initialization of `job`
+    template <typename T> struct Member {
+        Group* group;
+        T job;
+
+        auto run() {
+            if constexpr (queue::is_resumable_job<T>) {
+                auto const status = job.run();
+                if (status == queue::Status::Done) {
+                    group->finish();
+                }
+                return status;
+            } else {
+                job.run();
+                group->finish();
+            }
+        }
+    };
+
+    struct Ready {
+        Group* group;
+
+        auto operator()() const -> bool {
+            // (2) paired with release (1)
+            // note: acquire is required to see job memory side-effects
+            return atomic::load(&group->pending_, atomic::ACQUIRE) == 0;
+        }
+    };
+
+    auto finish() -> void {
+        // (1) paired with acquire (2)
+        atomic::sub(&pending_, 1u, atomic::RELEASE);
+    }
+
+  public:
+    // adds job of the group to `osca::jobs`
+    // returns:
+    //   true if job was added
+    //   false if queue was full
+    template <queue::is_job T, typename... Args>
+    auto try_add(Args&&... args) -> bool {
+        atomic::add(&pending_, 1u, atomic::RELAXED);
+        if (jobs.try_add<Member<T>>(this, fwd<Args>(args)...)) {
+            return true;
+        }
+        finish();
+        return false;
+    }
+
+    // adds job of the group to `osca::jobs`
+    // note: runs the job in the caller if the queue is full; unlike blocking
+    //       this cannot deadlock consumers adding from jobs
+    template <queue::is_job T, typename... Args>
+    auto add(Args&&... args) -> void {
+        if (try_add<T>(fwd<Args>(args)...)) {
+            return;
+        }
+
+        auto job = T{fwd<Args>(args)...};
+        if constexpr (queue::is_resumable_job<T>) {
+            while (job.run() != queue::Status::Done) {
+                kernel::core::pause();
+            }
+        } else {
+            job.run();
+        }
+    }
+
+    auto operator co_await() { return Until<Ready>{{this}}; }
+};
+
+template <typename T> class Task;
+
+// state shared by promises of all tasks
+template <typename Derived> struct PromiseBase {
+    // coroutine awaiting this task, resumed when it finishes
+    std::coroutine_handle<> continuation;
+    // frame is destroyed when finished
+    bool detached = false;
+
+    // frames are allocated from the pool
+    static auto operator new(usize const size) noexcept -> void* {
+        return frames::allocate(size);
+    }
+
+    static auto operator delete(void* const frame, usize const size) -> void {
+        frames::free(frame, size);
+    }
+
+    auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+
+    auto final_suspend() noexcept {
+        struct Awaiter {
+            auto await_ready() noexcept -> bool { return false; }
+
+            auto await_suspend(
+                std::coroutine_handle<Derived> const handle) noexcept -> void {
+                auto& promise = handle.promise();
+                auto const continuation = promise.continuation;
+                if (promise.detached) {
+                    handle.destroy();
+                }
+                if (continuation) {
+                    resume_later(continuation);
+                }
+            }
+
+            auto await_resume() noexcept -> void {}
+        };
+
+        return Awaiter{};
+    }
+
+    // note: the kernel has no exceptions; unreachable in practice
+    auto unhandled_exception() -> void { kernel::panic(0xff0000); }
+};
+
+template <typename T> struct Promise : PromiseBase<Promise<T>> {
+    alignas(T) u8 value[sizeof(T)];
+    bool has_value = false;
+
+    ~Promise() {
+        if (has_value) {
+            ptr<T>(value)->~T();
+        }
+    }
+
+    static auto get_return_object_on_allocation_failure() -> Task<T> {
+        return {};
+    }
+
+    auto get_return_object() -> Task<T> {
+        return Task<T>{std::coroutine_handle<Promise>::from_promise(*this)};
+    }
+
+    template <typename U> auto return_value(U&& v) -> void {
+        new (value) T{fwd<U>(v)};
+        has_value = true;
+    }
+
+    auto result() -> T&& { return static_cast<T&&>(*ptr<T>(value)); }
+};
+
+template <> struct Promise<void> : PromiseBase<Promise<void>> {
+    static auto get_return_object_on_allocation_failure() -> Task<void>;
+
+    auto get_return_object() -> Task<void>;
+
+    auto return_void() -> void {}
+
+    auto result() -> void {}
+};
+
+//
+// coroutine run on `osca::jobs`
+//
+// a task starts suspended and runs when awaited by another task or when
+// spawned
+//
+// usage:
+//   auto fetch() -> osca::Task<u32> { co_return 42; }
+//   auto flow() -> osca::Task<> {
+//       osca::Group group;
+//       group.add<Job>(...);
+//       co_await group;
+//       auto const value = co_await fetch();
+//   }
+//   osca::spawn(flow());
+//
+// note: a task is false if its frame could not be allocated; awaiting it
+//       panics
+//
+template <typename T = void> class Task final {
+  public:
+    using promise_type = Promise<T>;
+
+    Task() = default;
+
+    explicit Task(std::coroutine_handle<promise_type> const handle)
+        : handle_{handle} {}
+
+    Task(Task&& other) : handle_{other.release()} {}
+
+    auto operator=(Task&& other) -> Task& {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = other.release();
+        }
+        return *this;
+    }
+
+    Task(Task const&) = delete;
+    auto operator=(Task const&) -> Task& = delete;
+
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    explicit operator bool() const { return bool(handle_); }
+
+    // gives up ownership of the frame
+    auto release() -> std::coroutine_handle<promise_type> {
+        auto const handle = handle_;
+        handle_ = nullptr;
+        return handle;
+    }
+
+    // runs the task until it finishes then continues the awaiting coroutine
+    // note: the task starts on the awaiting core without a trip through the
+    //       queue
+    auto operator co_await() {
+        if (!handle_) {
+            // frame could not be allocated
+            kernel::panic(0xff00ff);
+        }
+
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            auto await_ready() -> bool { return false; }
+
+            auto await_suspend(std::coroutine_handle<> const awaiting)
+                -> std::coroutine_handle<> {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            auto await_resume() -> T { return handle.promise().result(); }
+        };
+
+        return Awaiter{handle_};
+    }
+
+  private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+auto inline Promise<void>::get_return_object_on_allocation_failure()
+    -> Task<void> {
+    return {};
+}
+
+auto inline Promise<void>::get_return_object() -> Task<void> {
+    return Task<void>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+
+// starts `task` on `osca::jobs`; the frame is freed when it finishes
+// note: blocks while queue is full, as `add`
+// returns:
+//   true if task was started
+//   false if the task's frame could not be allocated
+auto inline spawn(Task<>&& task) -> bool {
+    auto const handle = task.release();
+    if (!handle) {
+        return false;
+    }
+
+    handle.promise().detached = true;
+    jobs.add<Resume>(handle);
+    return true;
+}
+
+} // namespace osca
@@ -3,6 +3,14 @@
 #include <atomic>
 #include <cstdint>
 
+#include "kernel.hpp"
+
+// host stand-in for the kernel's index of the calling core
+// note: inline so that several translation units may include this file
+inline thread_local uint32_t current_core = 0;
+
+inline auto kernel::core::index() -> u32 { return current_core; }
+
 struct Job {
     uint64_t payload;
     uint64_t iterations;
@@ -0,0 +1,149 @@
+#include "alloc.hpp"
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+enum class Buffer { Malloc, Alloc, Scratch };
+
+// job that fills a temporary buffer, sums it and releases it
+struct Temporary {
+    uint32_t count;
+    Buffer buffer;
+    std::atomic<uint64_t>* completed;
+    std::atomic<uint64_t>* failures;
+
+    void run() {
+        // the arena of the core must have been reset after the previous job
+        if (buffer == Buffer::Scratch && osca::scratch.used() != 0) {
+            failures->fetch_add(1, std::memory_order_relaxed);
+        }
+
+        uint32_t* values = nullptr;
+        switch (buffer) {
+        case Buffer::Malloc:
+            values = ptr<uint32_t>(std::malloc(count * sizeof(uint32_t)));
+            break;
+        case Buffer::Alloc:
+            values = ptr<uint32_t>(
+                kernel::alloc::allocate(count * sizeof(uint32_t)));
+            break;
+        case Buffer::Scratch:
+            values = osca::scratch.allocate_array<uint32_t>(count);
+            break;
+        }
+        if (values == nullptr) {
+            failures->fetch_add(1, std::memory_order_relaxed);
+            completed->fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        for (auto i = 0u; i < count; ++i) {
+            values[i] = i;
+        }
+        asm volatile("" : : "g"(values) : "memory");
+        auto sum = uint64_t(0);
+        for (auto i = 0u; i < count; ++i) {
+            sum += values[i];
+        }
+        if (sum != uint64_t(count) * (count - 1) / 2) {
+            failures->fetch_add(1, std::memory_order_relaxed);
+        }
+
+        switch (buffer) {
+        case Buffer::Malloc:
+            std::free(values);
+            break;
+        case Buffer::Alloc:
+            kernel::alloc::free(values);
+            break;
+        case Buffer::Scratch:
+            break;
+        }
+        completed->fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+char const* const NAMES[] = {"malloc", "kernel::alloc", "scratch"};
+
+void run_test(uint32_t consumers, uint32_t jobs, uint32_t count,
+              Buffer buffer) {
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> failures{0};
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (auto i = 0u; i < jobs; ++i) {
+        osca::jobs.add<Temporary>(count, buffer, &completed, &failures);
+    }
+    osca::jobs.wait_idle();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    std::cout << "Results for " << NAMES[u32(buffer)] << " / " << consumers
+              << "C:\n";
+    std::cout << "      Time: " << diff.count() << " s" << "\n";
+    std::cout << "Throughput: " << (jobs / diff.count()) << " jobs/sec\n";
+    std::cout << "  Verified: " << completed.load() << " / " << jobs
+              << " (failures " << failures.load() << ")\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t jobs = (argc > 2) ? std::stoi(argv[2]) : 200000;
+    uint32_t count = (argc > 3) ? std::stoi(argv[3]) : 1024;
+    uint64_t scratch_kb = (argc > 4) ? std::stoull(argv[4]) : 64;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "     Jobs: " << jobs << "\n";
+    std::cout << "   Buffer: " << count * sizeof(uint32_t) << " B\n";
+    std::cout << "  Scratch: " << scratch_kb << " KB per core\n\n";
+
+    kernel::heap.size = 64 * 1024 * 1024;
+    kernel::heap.start = std::aligned_alloc(4096, kernel::heap.size);
+    kernel::alloc::init(consumers + 1);
+
+    // arenas of consumers carved from the heap
+    for (auto i = 0u; i < consumers; ++i) {
+        current_core = i;
+        osca::scratch.init(i, kernel::alloc::allocate(scratch_kb * 1024),
+                           scratch_kb * 1024);
+    }
+
+    osca::jobs.init();
+    osca::jobs.set_scratch(&osca::scratch);
+
+    run_test(consumers, jobs, count, Buffer::Malloc);
+    run_test(consumers, jobs, count, Buffer::Alloc);
+    run_test(consumers, jobs, count, Buffer::Scratch);
+
+    std::free(kernel::heap.start);
+}
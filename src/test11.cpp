@@ -0,0 +1,210 @@
+#include "alloc.hpp"
+#include "osca.hpp"
+#include "pool.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// payload too large for a queue slot
+template <uint32_t Size> struct Payload {
+    uint64_t tag;
+    std::atomic<uint64_t>* completed;
+    std::atomic<uint64_t>* failures;
+    uint64_t data[(Size - 24) / sizeof(uint64_t)];
+
+    // note: `data` is filled by the producer
+    Payload(uint64_t tag, std::atomic<uint64_t>* completed,
+            std::atomic<uint64_t>* failures)
+        : tag{tag}, completed{completed}, failures{failures} {}
+
+    void run() {
+        auto sum = uint64_t(0);
+        for (auto value : data) {
+            sum += value;
+        }
+        if (sum != tag * (sizeof(data) / sizeof(data[0]))) {
+            failures->fetch_add(1, std::memory_order_relaxed);
+        }
+        completed->fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+enum class Source { Malloc, Alloc, Pool };
+
+char const* const NAMES[] = {"malloc", "kernel::alloc", "osca::Pool"};
+
+// job referencing a payload from a general-purpose allocator
+template <typename T> struct Boxed {
+    T* payload;
+    bool system;
+
+    void run() {
+        payload->run();
+        if (system) {
+            std::free(payload);
+        } else {
+            kernel::alloc::free(payload);
+        }
+    }
+};
+
+template <uint32_t Size> osca::Pool<Payload<Size>> inline pool;
+
+template <uint32_t Size>
+void run_test(uint32_t consumers, uint32_t jobs, Source source) {
+    using T = Payload<Size>;
+    static_assert(sizeof(T) == Size);
+
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> failures{0};
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (auto i = 0u; i < jobs; ++i) {
+        auto const fill = [&](T& payload) {
+            for (auto& value : payload.data) {
+                value = i;
+            }
+        };
+
+        if (source == Source::Pool) {
+            // fill in place before the job can run
+            while (true) {
+                auto* const payload = pool<Size>.create(
+                    uint64_t(i), &completed, &failures);
+                if (payload == nullptr) {
+                    kernel::core::pause();
+                    continue;
+                }
+                fill(*payload);
+                osca::jobs.add<typename osca::Pool<T>::Job>(&pool<Size>,
+                                                            payload);
+                break;
+            }
+            continue;
+        }
+
+        auto const system = source == Source::Malloc;
+        auto* const payload =
+            ptr<T>(system ? std::malloc(sizeof(T))
+                          : kernel::alloc::allocate(sizeof(T)));
+        new (payload) T{uint64_t(i), &completed, &failures};
+        fill(*payload);
+        osca::jobs.add<Boxed<T>>(payload, system);
+    }
+    osca::jobs.wait_idle();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    std::cout << "Results for " << NAMES[uint32_t(source)] << " " << Size
+              << " B / " << consumers << "C:\n";
+    std::cout << "      Time: " << diff.count() << " s" << "\n";
+    std::cout << "Throughput: " << (jobs / diff.count()) << " jobs/sec\n";
+    std::cout << "  Verified: " << completed.load() << " / " << jobs
+              << " (failures " << failures.load() << ")\n\n";
+}
+
+// creates and destroys on the same core in batches
+template <uint32_t Size> void run_local(uint32_t rounds, Source source) {
+    using T = Payload<Size>;
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    T* payloads[64];
+    for (auto r = 0u; r < rounds; ++r) {
+        for (auto& payload : payloads) {
+            switch (source) {
+            case Source::Malloc:
+                payload = ptr<T>(std::malloc(sizeof(T)));
+                break;
+            case Source::Alloc:
+                payload = ptr<T>(kernel::alloc::allocate(sizeof(T)));
+                break;
+            case Source::Pool:
+                payload = pool<Size>.create(uint64_t(r), nullptr, nullptr);
+                break;
+            }
+            asm volatile("" : : "g"(payload) : "memory");
+        }
+        for (auto* payload : payloads) {
+            switch (source) {
+            case Source::Malloc:
+                std::free(payload);
+                break;
+            case Source::Alloc:
+                kernel::alloc::free(payload);
+                break;
+            case Source::Pool:
+                pool<Size>.destroy(payload);
+                break;
+            }
+        }
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    std::cout << "Results for " << NAMES[uint32_t(source)] << " " << Size
+              << " B same core:\n";
+    std::cout << "Throughput: " << (rounds * 64.0 / diff.count())
+              << " create+destroy/sec\n\n";
+}
+
+template <uint32_t Size> void run_all(uint32_t consumers, uint32_t jobs) {
+    run_test<Size>(consumers, jobs, Source::Malloc);
+    run_test<Size>(consumers, jobs, Source::Alloc);
+    run_test<Size>(consumers, jobs, Source::Pool);
+
+    current_core = consumers;
+    run_local<Size>(jobs / 64, Source::Malloc);
+    run_local<Size>(jobs / 64, Source::Alloc);
+    run_local<Size>(jobs / 64, Source::Pool);
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t jobs = (argc > 2) ? std::stoi(argv[2]) : 1000000;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "     Jobs: " << jobs << "\n\n";
+
+    kernel::heap.size = 64 * 1024 * 1024;
+    kernel::heap.start = std::aligned_alloc(4096, kernel::heap.size);
+    kernel::alloc::init(consumers + 1);
+
+    osca::jobs.init();
+    pool<128>.init();
+    pool<512>.init();
+
+    run_all<128>(consumers, jobs);
+    run_all<512>(consumers, jobs);
+
+    std::free(kernel::heap.start);
+}
@@ -0,0 +1,153 @@
+#include "osca.hpp"
+#include "pages.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+auto kernel::allocate_pages(u64 const num_pages) -> void* {
+    return kernel::pages::allocate_pages(num_pages);
+}
+
+// synthetic memory map over host memory standing in for physical memory
+// note: firmware descriptors are commonly 48 bytes apart
+struct alignas(8) RawDescriptor {
+    kernel::pages::Descriptor d;
+    uint64_t padding;
+};
+
+std::vector<RawDescriptor> descriptors;
+
+// returns usable pages in the map
+uint64_t build_memory_map(uint8_t* memory, uint64_t pages) {
+    auto const page = kernel::pages::PAGE_SIZE;
+    auto usable = 0ull;
+    auto add = [&](uint32_t type, uint64_t first, uint64_t count) {
+        RawDescriptor raw{};
+        raw.d.type = type;
+        raw.d.physical_start = uint64_t(memory + first * page);
+        raw.d.virtual_start = raw.d.physical_start;
+        raw.d.number_of_pages = count;
+        descriptors.push_back(raw);
+        if (type == kernel::pages::CONVENTIONAL_MEMORY) {
+            usable += count;
+        }
+    };
+
+    // layout in pages: loader data then conventional
+    add(2, 0, 1024);
+    add(kernel::pages::CONVENTIONAL_MEMORY, 1024, pages - 1024);
+
+    kernel::memory_map.buffer = descriptors.data();
+    kernel::memory_map.size = descriptors.size() * sizeof(RawDescriptor);
+    kernel::memory_map.descriptor_size = sizeof(RawDescriptor);
+    kernel::memory_map.descriptor_version = 1;
+
+    return usable;
+}
+
+// background work of idle consumers
+auto fill(u32) -> void { kernel::pages::fill_zeroed(); }
+
+// producer takes `batch` zeroed pages per round, verifies and dirties them
+// and frees them while consumers, if `idle`, refill the zeroed pages
+void run_test(uint32_t consumers, uint32_t rounds, uint32_t batch,
+              bool idle) {
+    osca::jobs.set_idle(idle ? fill : nullptr);
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    auto failures = 0ull;
+    auto ready = 0ull;
+    auto elapsed = std::chrono::duration<double>(0);
+    std::vector<uint64_t*> pages(batch);
+    for (auto r = 0u; r < rounds; ++r) {
+        // let idle consumers run
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ready += kernel::pages::zeroed_available();
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        for (auto& p : pages) {
+            p = ptr<uint64_t>(kernel::pages::allocate_zeroed_page());
+            asm volatile("" : : "g"(p) : "memory");
+        }
+        elapsed += std::chrono::high_resolution_clock::now() - start_time;
+
+        for (auto& p : pages) {
+            if (p == nullptr) {
+                ++failures;
+                continue;
+            }
+            for (auto i = 0u; i < kernel::pages::PAGE_SIZE / 8; ++i) {
+                if (p[i] != 0) {
+                    ++failures;
+                    break;
+                }
+            }
+            // dirty the page for the next round
+            p[r % (kernel::pages::PAGE_SIZE / 8)] = ~0ull;
+            kernel::pages::free_page(p);
+        }
+    }
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+    for (auto& c : consumer_threads) {
+        c.join();
+    }
+
+    auto const allocations = double(rounds) * batch;
+    std::cout << "Results for " << (idle ? "idle zeroing" : "zeroing on demand")
+              << " / " << consumers << "C:\n";
+    std::cout << "   Latency: " << (elapsed.count() * 1e9 / allocations)
+              << " ns/page\n";
+    std::cout << "  Prepared: " << (ready / double(rounds))
+              << " pages/round\n";
+    std::cout << "  Failures: " << failures << "\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t rounds = (argc > 2) ? std::stoi(argv[2]) : 200;
+    uint32_t batch = (argc > 3) ? std::stoi(argv[3]) : 64;
+    uint64_t memory_mb = (argc > 4) ? std::stoull(argv[4]) : 64;
+
+    auto const pages = memory_mb * 1024 * 1024 / kernel::pages::PAGE_SIZE;
+    auto* const memory = static_cast<uint8_t*>(std::aligned_alloc(
+        kernel::pages::PAGE_SIZE << kernel::pages::MAX_ORDER,
+        pages * kernel::pages::PAGE_SIZE));
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "   Rounds: " << rounds << "\n";
+    std::cout << "    Batch: " << batch << "\n";
+    std::cout << "   Memory: " << memory_mb << " MB\n\n";
+
+    build_memory_map(memory, pages);
+    kernel::pages::init(false);
+    osca::jobs.init();
+
+    run_test(consumers, rounds, batch, false);
+    run_test(consumers, rounds, batch, true);
+
+    std::free(memory);
+}
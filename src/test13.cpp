@@ -0,0 +1,155 @@
+#include "kernel.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "test.hpp"
+
+// reference copy and fill one byte at a time
+void copy_bytes(uint8_t* d, uint8_t const* s, uint64_t n) {
+    for (auto i = 0ull; i < n; ++i) {
+        asm("" : "+r"(d));
+        d[i] = s[i];
+    }
+}
+
+void rep_movsb(void* d, void const* s, uint64_t n) {
+    asm volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+}
+
+void rep_stosb(void* d, uint8_t c, uint64_t n) {
+    asm volatile("rep stosb" : "+D"(d), "+c"(n) : "a"(c) : "memory");
+}
+
+// copies and fills every size and alignment against the reference and checks
+// that bytes around the destination are untouched
+uint64_t verify(std::vector<uint64_t> const& sizes) {
+    auto failures = 0ull;
+    auto const max = sizes.back() + 64;
+    std::vector<uint8_t> src(max), dst(max), expected(max);
+    for (auto i = 0ull; i < max; ++i) {
+        src[i] = uint8_t(i * 7 + 3);
+    }
+
+    for (auto n : sizes) {
+        for (auto d_offset = 0u; d_offset < 16; ++d_offset) {
+            for (auto s_offset : {0u, 1u, 8u, 15u}) {
+                std::fill(dst.begin(), dst.end(), 0xaa);
+                std::fill(expected.begin(), expected.end(), 0xaa);
+                copy_bytes(&expected[d_offset], &src[s_offset], n);
+                kernel::memory::copy(&dst[d_offset], &src[s_offset], n);
+                if (dst != expected) {
+                    ++failures;
+                }
+            }
+
+            std::fill(dst.begin(), dst.end(), 0xaa);
+            std::fill(expected.begin(), expected.end(), 0xaa);
+            for (auto i = 0ull; i < n; ++i) {
+                expected[d_offset + i] = uint8_t(n);
+            }
+            kernel::memory::fill(&dst[d_offset], uint8_t(n), n);
+            if (dst != expected) {
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+// returns bytes per nanosecond of `f` over `bytes` total
+template <typename F> double bandwidth(uint64_t n, uint64_t bytes, F f) {
+    auto const rounds = bytes / n + 1;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0ull; r < rounds; ++r) {
+        f();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> diff = end_time - start_time;
+    return rounds * n / diff.count();
+}
+
+void run_benchmark(std::vector<uint64_t> const& sizes, uint64_t bytes) {
+    auto const max = sizes.back() + 64;
+    auto* const src = static_cast<uint8_t*>(std::aligned_alloc(4096, max));
+    auto* const dst = static_cast<uint8_t*>(std::aligned_alloc(4096, max));
+    std::fill(src, src + max, 1);
+    std::fill(dst, dst + max, 2);
+
+    std::cout << "      size align   copy GB/s  movsb GB/s   fill GB/s"
+                 "  stosb GB/s\n";
+    for (auto n : sizes) {
+        for (auto align : {0u, 3u}) {
+            auto* const d = dst + align;
+            auto* const s = src + align * 2;
+            auto const copy = bandwidth(n, bytes, [&] {
+                kernel::memory::copy(d, s, n);
+                asm volatile("" : : "g"(d) : "memory");
+            });
+            auto const movsb = bandwidth(n, bytes, [&] {
+                rep_movsb(d, s, n);
+                asm volatile("" : : "g"(d) : "memory");
+            });
+            auto const fill = bandwidth(n, bytes, [&] {
+                kernel::memory::fill(d, 0, n);
+                asm volatile("" : : "g"(d) : "memory");
+            });
+            auto const stosb = bandwidth(n, bytes, [&] {
+                rep_stosb(d, 0, n);
+                asm volatile("" : : "g"(d) : "memory");
+            });
+            std::printf("%10llu %5u %11.2f %11.2f %11.2f %11.2f\n",
+                        (unsigned long long)n, align, copy, movsb, fill, stosb);
+        }
+    }
+    std::cout << "\n";
+
+    std::free(src);
+    std::free(dst);
+}
+
+int main(int argc, char** argv) {
+    uint64_t bytes_mb = (argc > 1) ? std::stoull(argv[1]) : 256;
+
+    kernel::cpu::init();
+    auto const& f = kernel::cpu::features;
+    std::cout << " Features: avx " << f.avx << ", avx2 " << f.avx2
+              << ", erms " << f.erms << ", fsrm " << f.fsrm << "\n";
+    std::cout << "    Bytes: " << bytes_mb << " MB per measure\n\n";
+
+    // every size across the small and vector tiers, then tier edges
+    std::vector<uint64_t> sizes;
+    for (auto n = 0ull; n <= 300; ++n) {
+        sizes.push_back(n);
+    }
+    for (auto n : {1000ull, 2047ull, 2048ull, 2049ull, 4099ull, 65536ull,
+                   kernel::memory::STREAMING_THRESHOLD,
+                   kernel::memory::STREAMING_THRESHOLD + 1,
+                   kernel::memory::STREAMING_THRESHOLD + 77}) {
+        sizes.push_back(n);
+    }
+
+    // each path with and without avx, and with the rep tier off, from
+    // `ERMS_THRESHOLD` and from `FSRM_THRESHOLD`
+    auto failures = 0ull;
+    auto const detected = f;
+    for (auto avx : {false, detected.avx}) {
+        for (auto erms : {false, true}) {
+            for (auto fsrm : {false, true}) {
+                kernel::cpu::features.avx = avx;
+                kernel::cpu::features.erms = erms;
+                kernel::cpu::features.fsrm = fsrm;
+                failures += verify(sizes);
+            }
+        }
+    }
+    kernel::cpu::features = detected;
+    std::cout << " Verified: " << sizes.size() << " sizes (failures "
+              << failures << ")\n\n";
+
+    run_benchmark({8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 16384,
+                   65536, 262144, 1048576, 4194304, 16777216},
+                  bytes_mb * 1024 * 1024);
+}
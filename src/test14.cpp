@@ -0,0 +1,242 @@
+#include "kernel.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <iostream>
+#include <vector>
+
+#include "test.hpp"
+
+// libc functions behind the kernel's replacements in this executable
+using MemmoveFn = void* (*)(void*, void const*, size_t);
+using MemcmpFn = int (*)(void const*, void const*, size_t);
+using MemchrFn = void* (*)(void const*, int, size_t);
+
+MemmoveFn libc_memmove;
+MemcmpFn libc_memcmp;
+MemchrFn libc_memchr;
+
+auto sign(int v) -> int { return (v > 0) - (v < 0); }
+
+uint64_t verify_move(std::vector<uint64_t> const& sizes) {
+    auto failures = 0ull;
+    auto const max = sizes.back() + 128;
+    std::vector<uint8_t> buffer(max), expected(max);
+
+    for (auto n : sizes) {
+        // destination before, at and after the source, overlapping or not
+        for (auto shift : {-40, -17, -16, -1, 0, 1, 15, 16, 33, 64}) {
+            auto const s = 64ull;
+            auto const d = uint64_t(int64_t(s) + shift);
+            for (auto i = 0ull; i < max; ++i) {
+                buffer[i] = uint8_t(i * 13 + 5);
+            }
+            expected = buffer;
+            libc_memmove(&expected[d], &expected[s], n);
+            kernel::memory::move(&buffer[d], &buffer[s], n);
+            if (buffer != expected) {
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+uint64_t verify_compare(std::vector<uint64_t> const& sizes) {
+    auto failures = 0ull;
+    auto const max = sizes.back() + 16;
+    std::vector<uint8_t> a(max), b(max);
+    for (auto i = 0ull; i < max; ++i) {
+        a[i] = b[i] = uint8_t(i * 31 + 1);
+    }
+
+    for (auto n : sizes) {
+        for (auto offset : {0u, 1u, 7u}) {
+            auto* const pa = &a[offset];
+            auto* const pb = &b[offset];
+            if (sign(kernel::memory::compare(pa, pb, n)) !=
+                sign(libc_memcmp(pa, pb, n))) {
+                ++failures;
+            }
+
+            // a single differing byte below and above at each position,
+            // positions sampled for large sizes
+            auto const step = n > 300 ? n / 61 + 1 : 1;
+            for (auto i = 0ull; i < n; i += step) {
+                for (auto delta : {1, 0x80}) {
+                    auto const saved = pb[i];
+                    pb[i] = uint8_t(saved + delta);
+                    if (sign(kernel::memory::compare(pa, pb, n)) !=
+                        sign(libc_memcmp(pa, pb, n))) {
+                        ++failures;
+                    }
+                    pb[i] = saved;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+uint64_t verify_find(std::vector<uint64_t> const& sizes) {
+    auto failures = 0ull;
+    auto const max = sizes.back() + 16;
+    std::vector<uint8_t> buffer(max);
+
+    for (auto n : sizes) {
+        for (auto offset : {0u, 3u}) {
+            auto* const p = &buffer[offset];
+            std::fill(buffer.begin(), buffer.end(), 0x11);
+            // needle past the end must not be found
+            buffer[offset + n] = 0xfe;
+            if (kernel::memory::find(p, 0xfe, n) != libc_memchr(p, 0xfe, n)) {
+                ++failures;
+            }
+
+            auto const step = n > 300 ? n / 61 + 1 : 1;
+            for (auto i = 0ull; i < n; i += step) {
+                p[i] = 0xfe;
+                // a later duplicate must not be found first
+                if (i + 5 < n) {
+                    p[i + 5] = 0xfe;
+                }
+                if (kernel::memory::find(p, 0xfe, n) !=
+                    libc_memchr(p, 0xfe, n)) {
+                    ++failures;
+                }
+                p[i] = 0x11;
+                if (i + 5 < n) {
+                    p[i + 5] = 0x11;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+uint64_t verify_zero(std::vector<uint64_t> const& sizes) {
+    auto failures = 0ull;
+    auto const max = sizes.back() + 64;
+    std::vector<uint8_t> buffer(max), expected(max);
+
+    for (auto n : sizes) {
+        for (auto offset : {0u, 5u, 16u}) {
+            std::fill(buffer.begin(), buffer.end(), 0x77);
+            expected = buffer;
+            std::fill(expected.begin() + offset,
+                      expected.begin() + offset + n, 0);
+            kernel::memory::zero(&buffer[offset], n);
+            if (buffer != expected) {
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+// returns bytes per nanosecond of `f` over `bytes` total
+template <typename F> double bandwidth(uint64_t n, uint64_t bytes, F f) {
+    auto const rounds = bytes / n + 1;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0ull; r < rounds; ++r) {
+        f();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> diff = end_time - start_time;
+    return rounds * n / diff.count();
+}
+
+void run_benchmark(std::vector<uint64_t> const& sizes, uint64_t bytes) {
+    auto const max = sizes.back() + 64;
+    auto* const a = static_cast<uint8_t*>(std::aligned_alloc(4096, max));
+    auto* const b = static_cast<uint8_t*>(std::aligned_alloc(4096, max));
+    std::fill(a, a + max, 1);
+    std::fill(b, b + max, 1);
+
+    std::cout << "      size  memmove GB/s  libc GB/s  memcmp GB/s  libc GB/s"
+                 "  memchr GB/s  libc GB/s\n";
+    for (auto n : sizes) {
+        // overlapping move backward by one cache line
+        auto const move = bandwidth(n, bytes, [&] {
+            kernel::memory::move(a + 64, a, n);
+            asm volatile("" : : "g"(a) : "memory");
+        });
+        auto const libc_move = bandwidth(n, bytes, [&] {
+            libc_memmove(a + 64, a, n);
+            asm volatile("" : : "g"(a) : "memory");
+        });
+        std::fill(a, a + max, 1);
+
+        auto const compare = bandwidth(n, bytes, [&] {
+            auto r = kernel::memory::compare(a, b, n);
+            asm volatile("" : : "g"(r) : "memory");
+        });
+        auto const libc_compare = bandwidth(n, bytes, [&] {
+            auto r = libc_memcmp(a, b, n);
+            asm volatile("" : : "g"(r) : "memory");
+        });
+
+        auto const find = bandwidth(n, bytes, [&] {
+            auto* r = kernel::memory::find(a, 2, n);
+            asm volatile("" : : "g"(r) : "memory");
+        });
+        auto const libc_find = bandwidth(n, bytes, [&] {
+            auto* r = libc_memchr(a, 2, n);
+            asm volatile("" : : "g"(r) : "memory");
+        });
+
+        std::printf("%10llu %13.2f %10.2f %12.2f %10.2f %12.2f %10.2f\n",
+                    (unsigned long long)n, move, libc_move, compare,
+                    libc_compare, find, libc_find);
+    }
+    std::cout << "\n";
+
+    std::free(a);
+    std::free(b);
+}
+
+int main(int argc, char** argv) {
+    uint64_t bytes_mb = (argc > 1) ? std::stoull(argv[1]) : 256;
+
+    libc_memmove = reinterpret_cast<MemmoveFn>(dlsym(RTLD_NEXT, "memmove"));
+    libc_memcmp = reinterpret_cast<MemcmpFn>(dlsym(RTLD_NEXT, "memcmp"));
+    libc_memchr = reinterpret_cast<MemchrFn>(dlsym(RTLD_NEXT, "memchr"));
+    if (!libc_memmove || !libc_memcmp || !libc_memchr) {
+        std::cout << "libc functions not found\n";
+        return 1;
+    }
+
+    kernel::cpu::init();
+    std::cout << "    Bytes: " << bytes_mb << " MB per measure\n\n";
+
+    // every size across the small and vector tiers, then tier edges
+    std::vector<uint64_t> sizes;
+    for (auto n = 0ull; n <= 300; ++n) {
+        sizes.push_back(n);
+    }
+    for (auto n : {1000ull, 2047ull, 2048ull, 2049ull, 4099ull, 65536ull,
+                   kernel::memory::STREAMING_THRESHOLD + 77}) {
+        sizes.push_back(n);
+    }
+
+    // memmove with and without the rep tier
+    auto const detected = kernel::cpu::features;
+    auto move = 0ull;
+    for (auto erms : {false, true}) {
+        kernel::cpu::features.erms = erms;
+        move += verify_move(sizes);
+    }
+    kernel::cpu::features = detected;
+
+    auto const compare = verify_compare(sizes);
+    auto const find = verify_find(sizes);
+    auto const zero = verify_zero(sizes);
+    std::cout << " Verified: " << sizes.size() << " sizes (failures memmove "
+              << move << ", memcmp " << compare << ", memchr " << find
+              << ", bzero " << zero << ")\n\n";
+
+    run_benchmark({8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1048576},
+                  bytes_mb * 1024 * 1024);
+}
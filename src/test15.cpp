@@ -0,0 +1,105 @@
+#include "osca.hpp"
+#include "parallel.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// fills and copies `size` bytes `rounds` times with `consumers` helping
+void run_test(uint32_t consumers, uint32_t rounds, uint64_t size,
+              uint8_t* src, uint8_t* dst) {
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // caller core index is after consumers
+    current_core = consumers;
+
+    auto failures = 0ull;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0u; r < rounds; ++r) {
+        osca::parallel_memset(src, uint8_t(r + 1), size);
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> fill_time = end_time - start_time;
+
+    // every page of the region has the last value
+    for (auto i = 0ull; i < size; i += 4096 - 1) {
+        failures += src[i] != uint8_t(rounds);
+    }
+    failures += src[size - 1] != uint8_t(rounds);
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0u; r < rounds; ++r) {
+        osca::parallel_memcpy(dst, src, size);
+    }
+    end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> copy_time = end_time - start_time;
+
+    for (auto i = 0ull; i < size; i += 4096 - 1) {
+        failures += dst[i] != uint8_t(rounds);
+    }
+    failures += dst[size - 1] != uint8_t(rounds);
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    auto const bytes = double(size) * rounds;
+    std::cout << "Results for " << consumers << "C + caller:\n";
+    std::cout << "      Fill: " << (bytes / fill_time.count() / 1e9)
+              << " GB/s\n";
+    std::cout << "      Copy: " << (bytes / copy_time.count() / 1e9)
+              << " GB/s\n";
+    std::cout << "  Failures: " << failures << "\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t max_consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t rounds = (argc > 2) ? std::stoi(argv[2]) : 20;
+    uint64_t size_mb = (argc > 3) ? std::stoull(argv[3]) : 64;
+
+    std::cout << "Consumers: 0 to " << max_consumers << "\n";
+    std::cout << "   Rounds: " << rounds << "\n";
+    std::cout << "     Size: " << size_mb << " MB\n\n";
+
+    // note: odd offsets so pieces do not start on chunk boundaries
+    auto const size = size_mb * 1024 * 1024;
+    auto* const src =
+        static_cast<uint8_t*>(std::aligned_alloc(4096, size + 4096));
+    auto* const dst =
+        static_cast<uint8_t*>(std::aligned_alloc(4096, size + 4096));
+
+    kernel::cpu::init();
+
+    // fault in the pages before measuring
+    kernel::memory::fill(src, 0, size + 4096);
+    kernel::memory::fill(dst, 0, size + 4096);
+    osca::jobs.init();
+
+    for (auto consumers = 0u; consumers <= max_consumers;
+         consumers = consumers ? consumers * 2 : 1) {
+        run_test(consumers, rounds, size, src + 100, dst + 3);
+    }
+
+    // below the threshold the caller does it alone
+    run_test(0, rounds, osca::PARALLEL_THRESHOLD - 1, src, dst);
+
+    std::free(src);
+    std::free(dst);
+}
@@ -0,0 +1,144 @@
+#include "log.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// writers log numbered records while a drainer feeds them to a file, then the
+// file is checked for whole records in order per writer
+void run_test(uint32_t writers, uint32_t records, char const* path) {
+    auto* const file = std::fopen(path, "w+");
+    kernel::log::sink_fd = fileno(file);
+    auto const dropped_before = kernel::log::dropped();
+
+    std::atomic<uint32_t> done{0};
+
+    // drainer on its own core index
+    std::jthread drainer([&, writers] {
+        current_core = writers;
+        while (done.load(std::memory_order_acquire) < writers) {
+            if (kernel::log::drain() == 0) {
+                std::this_thread::yield();
+            }
+        }
+        kernel::log::drain();
+    });
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::jthread> writer_threads;
+    for (auto w = 0u; w < writers; ++w) {
+        writer_threads.emplace_back([&, w] {
+            current_core = w;
+            for (auto r = 0u; r < records; ++r) {
+                while (!kernel::log::print("core ", w, " record ", r, " at ",
+                                           kernel::log::Hex{r * 4096ull},
+                                           "\n")) {
+                    // let the drainer catch up instead of dropping
+                    std::this_thread::yield();
+                }
+            }
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    for (auto& w : writer_threads) {
+        w.join();
+    }
+    drainer.join();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    std::fclose(file);
+
+    // each line is whole and records of a writer are in order
+    auto failures = 0ull;
+    auto lines = 0ull;
+    std::vector<uint32_t> next(writers, 0);
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        ++lines;
+        unsigned w = 0, r = 0;
+        unsigned long long address = 0;
+        if (std::sscanf(line.c_str(), "core %u record %u at %llX", &w, &r,
+                        &address) != 3 ||
+            w >= writers || r != next[w] || address != r * 4096ull) {
+            ++failures;
+            continue;
+        }
+        ++next[w];
+    }
+    std::remove(path);
+
+    std::cout << "Results for " << writers << " writers:\n";
+    std::cout << "      Time: " << diff.count() << " s" << "\n";
+    std::cout << "Throughput: " << (double(writers) * records / diff.count())
+              << " records/sec\n";
+    std::cout << "     Lines: " << lines << " / "
+              << uint64_t(writers) * records << " (retried while full "
+              << kernel::log::dropped() - dropped_before << ", failures "
+              << failures << ")\n\n";
+}
+
+// cost to the writing core of a record logged through the ring or written
+// directly
+void run_cost(uint32_t records, char const* path) {
+    auto* const file = std::fopen(path, "w");
+    kernel::log::sink_fd = fileno(file);
+    current_core = 0;
+
+    auto ring = std::chrono::duration<double>(0);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0u; r < records; ++r) {
+        if (!kernel::log::print("record ", r, " at ",
+                                kernel::log::Hex{r * 4096ull}, "\n")) {
+            // drain outside the measured time
+            ring += std::chrono::high_resolution_clock::now() - start_time;
+            kernel::log::drain();
+            start_time = std::chrono::high_resolution_clock::now();
+            --r;
+        }
+    }
+    ring += std::chrono::high_resolution_clock::now() - start_time;
+    kernel::log::drain();
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0u; r < records; ++r) {
+        kernel::log::Line line;
+        line.text("record ").dec(r).text(" at ").hex(r * 4096ull).chr('\n');
+        kernel::log::default_sink(line.data, line.size);
+    }
+    std::chrono::duration<double> direct =
+        std::chrono::high_resolution_clock::now() - start_time;
+
+    std::fclose(file);
+    std::remove(path);
+
+    std::cout << "Cost per record on the writing core:\n";
+    std::cout << "      Ring: " << (ring.count() * 1e9 / records) << " ns\n";
+    std::cout << "    Direct: " << (direct.count() * 1e9 / records)
+              << " ns\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t writers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t records = (argc > 2) ? std::stoi(argv[2]) : 100000;
+
+    std::cout << "  Writers: " << writers << "\n";
+    std::cout << "  Records: " << records << " per writer\n\n";
+
+    auto const* const path = "test16.log";
+    run_test(1, records, path);
+    run_test(writers, records, path);
+    run_cost(records, path);
+}
@@ -0,0 +1,287 @@
+#include "uart.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// 16550 stand-in with a 16 byte transmit fifo draining at the baud rate and
+// the fifo empty interrupt
+// note: baud rate is `speedup` times the programmed one to keep tests short
+class SimPort {
+    std::mutex mutex_;
+    uint8_t ier_ = 0;
+    uint8_t lcr_ = 0;
+    uint16_t divisor_ = 1;
+    bool fifo_enabled_ = false;
+    // bytes in fifo and shift register
+    uint32_t fifo_ = 0;
+    uint8_t fifo_bytes_[kernel::uart::FIFO_SIZE];
+    uint32_t fifo_head_ = 0;
+    Clock::time_point last_ = Clock::now();
+    // interrupt pending until iir is read
+    bool thre_pending_ = false;
+
+  public:
+    uint32_t speedup = 1;
+    std::vector<uint8_t> transmitted;
+    uint64_t overruns = 0;
+    uint64_t port_writes = 0;
+    uint64_t status_reads = 0;
+
+    // 10 bits per byte at the programmed baud
+    auto byte_time() const -> std::chrono::nanoseconds {
+        auto const baud = 115200.0 * speedup / divisor_;
+        return std::chrono::nanoseconds(uint64_t(10e9 / baud));
+    }
+
+    auto capacity() const -> uint32_t {
+        return fifo_enabled_ ? kernel::uart::FIFO_SIZE : 1;
+    }
+
+    // moves bytes on the line since last update
+    auto advance() -> void {
+        auto const now = Clock::now();
+        if (fifo_ == 0) {
+            last_ = now;
+            return;
+        }
+        while (fifo_ && now - last_ >= byte_time()) {
+            last_ += byte_time();
+            transmitted.push_back(
+                fifo_bytes_[(fifo_head_ + kernel::uart::FIFO_SIZE - fifo_) %
+                            kernel::uart::FIFO_SIZE]);
+            --fifo_;
+            if (fifo_ == 0 && (ier_ & kernel::uart::IER_THRE)) {
+                thre_pending_ = true;
+            }
+        }
+    }
+
+    auto out(u16 const port, u8 const value) -> void {
+        std::lock_guard guard(mutex_);
+        advance();
+        ++port_writes;
+        auto const dlab = lcr_ & kernel::uart::LCR_DLAB;
+        switch (port - kernel::uart::COM1) {
+        case kernel::uart::THR:
+            if (dlab) {
+                divisor_ = uint16_t((divisor_ & 0xff00) | value);
+            } else if (fifo_ == capacity()) {
+                ++overruns;
+            } else {
+                fifo_bytes_[fifo_head_] = value;
+                fifo_head_ = (fifo_head_ + 1) % kernel::uart::FIFO_SIZE;
+                ++fifo_;
+                thre_pending_ = false;
+            }
+            break;
+        case kernel::uart::IER:
+            if (dlab) {
+                divisor_ = uint16_t((divisor_ & 0xff) | (value << 8));
+            } else {
+                // enabling with an empty fifo raises the interrupt at once
+                thre_pending_ = (value & kernel::uart::IER_THRE) && fifo_ == 0;
+                ier_ = value;
+            }
+            break;
+        case kernel::uart::FCR:
+            fifo_enabled_ = value & 1;
+            break;
+        case kernel::uart::LCR:
+            lcr_ = value;
+            break;
+        }
+    }
+
+    auto in(u16 const port) -> u8 {
+        std::lock_guard guard(mutex_);
+        advance();
+        switch (port - kernel::uart::COM1) {
+        case kernel::uart::IIR:
+            if (thre_pending_) {
+                thre_pending_ = false;
+                return kernel::uart::IIR_THRE;
+            }
+            return kernel::uart::IIR_NONE;
+        case kernel::uart::LSR:
+            ++status_reads;
+            return fifo_ == 0 ? kernel::uart::LSR_THRE : 0;
+        }
+        return 0;
+    }
+
+    // true if the interrupt line is raised
+    auto interrupt() -> bool {
+        std::lock_guard guard(mutex_);
+        advance();
+        return thre_pending_;
+    }
+
+    auto disable_interrupts() -> bool { return false; }
+    auto restore_interrupts(bool) -> void {}
+
+    auto reset_counters() -> void {
+        std::lock_guard guard(mutex_);
+        transmitted.clear();
+        overruns = 0;
+        port_writes = 0;
+        status_reads = 0;
+    }
+};
+
+kernel::uart::Uart16550<SimPort> inline uart;
+
+// writes `lines` from each of `writers` through the ring while an interrupt
+// thread refills the fifo
+void run_test(uint32_t writers, uint32_t lines) {
+    auto& port = uart.port();
+    port.reset_counters();
+
+    // stands in for the interrupt handler
+    std::jthread interrupt([](std::stop_token st) {
+        while (!st.stop_requested()) {
+            if (uart.port().interrupt()) {
+                uart.on_interrupt();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    auto start_time = Clock::now();
+
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> calls{0};
+    std::atomic<int64_t> writer_ns{0};
+    std::vector<std::jthread> writer_threads;
+    for (auto w = 0u; w < writers; ++w) {
+        writer_threads.emplace_back([&, w] {
+            current_core = w;
+            char line[64];
+            for (auto i = 0u; i < lines; ++i) {
+                auto const size = uint32_t(
+                    std::snprintf(line, sizeof(line), "writer %u line %u\n", w,
+                                  i));
+                auto const* data = reinterpret_cast<u8 const*>(line);
+                auto left = size;
+                auto const t = Clock::now();
+                auto written = uart.write(data, left);
+                writer_ns += (Clock::now() - t).count();
+                ++calls;
+                while (written < left) {
+                    // ring full, wait for the line
+                    data += written;
+                    left -= written;
+                    std::this_thread::yield();
+                    auto const r = Clock::now();
+                    written = uart.write(data, left);
+                    writer_ns += (Clock::now() - r).count();
+                    ++calls;
+                }
+                bytes += size;
+            }
+        });
+    }
+    for (auto& w : writer_threads) {
+        w.join();
+    }
+    // note: the line is far slower than the writers, so the transmitter is
+    //       busy and the fifo empty interrupt refills it
+    auto const status_reads = port.status_reads;
+    uart.flush();
+    // last bytes leave the fifo
+    while (port.in(kernel::uart::COM1 + kernel::uart::LSR) == 0) {
+        std::this_thread::yield();
+    }
+
+    std::chrono::duration<double> diff = Clock::now() - start_time;
+    interrupt.request_stop();
+    interrupt.join();
+
+    // a single writer's output is exact
+    auto failures = port.transmitted.size() != bytes ? 1ull : 0ull;
+    // writes read the line status only to start an idle transmitter
+    failures += status_reads * 4 > calls;
+    if (writers == 1) {
+        std::string expected;
+        char line[64];
+        for (auto i = 0u; i < lines; ++i) {
+            std::snprintf(line, sizeof(line), "writer 0 line %u\n", i);
+            expected += line;
+        }
+        failures += std::string(port.transmitted.begin(),
+                                port.transmitted.end()) != expected;
+    }
+
+    auto const ideal = std::chrono::duration<double>(port.byte_time()) *
+                       double(bytes);
+    std::cout << "Results for " << writers << " writers, ring:\n";
+    std::cout << "      Time: " << diff.count() << " s (line "
+              << (ideal.count() / diff.count() * 100) << "% busy)\n";
+    std::cout << "    Writer: " << (double(writer_ns) / lines / writers)
+              << " ns/line\n";
+    std::cout << "  Port I/O: " << port.port_writes << " writes for " << bytes
+              << " bytes\n";
+    std::cout << "    Status: " << status_reads << " reads for " << calls
+              << " writes\n";
+    std::cout << "  Verified: " << port.transmitted.size() << " / " << bytes
+              << " bytes (overruns " << port.overruns << ", failures "
+              << failures << ")\n\n";
+}
+
+// writes `lines` polling the line status before each byte, as without the
+// driver
+void run_blocking(uint32_t lines) {
+    auto& port = uart.port();
+    port.reset_counters();
+
+    auto bytes = 0ull;
+    auto start_time = Clock::now();
+    char line[64];
+    for (auto i = 0u; i < lines; ++i) {
+        auto const size = uint32_t(
+            std::snprintf(line, sizeof(line), "writer 0 line %u\n", i));
+        for (auto j = 0u; j < size; ++j) {
+            while (!(port.in(kernel::uart::COM1 + kernel::uart::LSR) &
+                     kernel::uart::LSR_THRE)) {
+            }
+            port.out(kernel::uart::COM1 + kernel::uart::THR, u8(line[j]));
+        }
+        bytes += size;
+    }
+    std::chrono::duration<double> diff = Clock::now() - start_time;
+
+    std::cout << "Results for blocking writes:\n";
+    std::cout << "    Writer: " << (diff.count() * 1e9 / lines)
+              << " ns/line\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t writers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t lines = (argc > 2) ? std::stoi(argv[2]) : 2000;
+    uint32_t speedup = (argc > 3) ? std::stoi(argv[3]) : 8;
+
+    std::cout << "  Writers: " << writers << "\n";
+    std::cout << "    Lines: " << lines << " per writer\n";
+    std::cout << "     Baud: " << 115200 * speedup << " (simulated)\n\n";
+
+    uart.port().speedup = speedup;
+    uart.init(kernel::uart::COM1, kernel::uart::divisor_of(115200));
+
+    run_test(1, lines);
+    run_test(writers, lines);
+    run_blocking(lines);
+
+    std::cout << "  Refused: " << uart.dropped()
+              << " bytes while ring full, written again\n";
+}
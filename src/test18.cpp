@@ -0,0 +1,129 @@
+#include "log.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "logtool.hpp"
+#include "test.hpp"
+
+// the table is generated from this file as the build would from the sources
+auto table_of_source() -> logtool::Table {
+    std::ifstream file(__FILE__);
+    std::stringstream source;
+    source << file.rdbuf();
+    logtool::Table table;
+    if (!logtool::add_source(table, source.str())) {
+        std::cout << "formats with the same id\n";
+    }
+    return table;
+}
+
+// logs the same records as text and binary, decodes the log and checks that
+// both render alike, and compares bytes and cost per record on the writer
+void run_test(uint32_t records, char const* path) {
+    auto* const file = std::fopen(path, "w");
+    kernel::log::sink_fd = fileno(file);
+    current_core = 0;
+
+    // text
+    auto text = std::chrono::duration<double>(0);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0u; r < records; ++r) {
+        if (!kernel::log::print("record ", r, " delta ", int32_t(r) - 1000,
+                                " at ", kernel::log::Hex{r * 4096ull}, "\n")) {
+            // drain outside the measured time
+            text += std::chrono::high_resolution_clock::now() - start_time;
+            kernel::log::drain();
+            start_time = std::chrono::high_resolution_clock::now();
+            --r;
+        }
+    }
+    text += std::chrono::high_resolution_clock::now() - start_time;
+    kernel::log::drain();
+    auto const text_bytes = std::ftell(file);
+
+    // binary
+    auto binary = std::chrono::duration<double>(0);
+    start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0u; r < records; ++r) {
+        if (!kernel::log::binary("record {} delta {i} at {x}\n", r,
+                                 int32_t(r) - 1000, r * 4096ull)) {
+            binary += std::chrono::high_resolution_clock::now() - start_time;
+            kernel::log::drain();
+            start_time = std::chrono::high_resolution_clock::now();
+            --r;
+        }
+    }
+    binary += std::chrono::high_resolution_clock::now() - start_time;
+    kernel::log::drain();
+    auto const binary_bytes = std::ftell(file) - text_bytes;
+    std::fclose(file);
+
+    // the decoded log holds every record twice, text then binary
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream decoded;
+    auto const stats = logtool::decode(table_of_source(), in, decoded);
+    std::remove(path);
+
+    auto const out = decoded.str();
+    auto const half = out.size() / 2;
+    auto failures = 0ull;
+    if (out.size() % 2 || out.compare(0, half, out, half, half) != 0) {
+        ++failures;
+    }
+    if (stats.records != records || stats.unknown || stats.malformed) {
+        ++failures;
+    }
+
+    std::cout << "Results for " << records << " records:\n";
+    std::cout << "      Text: " << (text.count() * 1e9 / records) << " ns, "
+              << (double(text_bytes) / records) << " bytes\n";
+    std::cout << "    Binary: " << (binary.count() * 1e9 / records) << " ns, "
+              << (double(binary_bytes) / records) << " bytes\n";
+    std::cout << "   Decoded: " << stats.records << " (unknown "
+              << stats.unknown << ", malformed " << stats.malformed
+              << ", failures " << failures << ")\n\n";
+}
+
+// records of unknown formats and truncated streams are reported
+void run_errors() {
+    logtool::Table table;
+    table[kernel::format::id("known {}\n")] = "known {}\n";
+
+    // unknown id, then a known record cut short
+    std::string log = "text\n";
+    log += char(kernel::log::BINARY);
+    log += std::string("\x01\x02\x03\x04\x00", 5);
+    auto const id = kernel::format::id("known {}\n");
+    log += char(kernel::log::BINARY);
+    log += char(id);
+    log += char(id >> 8);
+    log += char(id >> 16);
+    log += char(id >> 24);
+    log += char(2);
+    log += char(0x81);
+
+    std::istringstream in(log);
+    std::stringstream out;
+    auto const stats = logtool::decode(table, in, out);
+    auto const failures = (stats.records != 1 || stats.unknown != 1 ||
+                           stats.malformed != 1 ||
+                           out.str() != "text\n<unknown format 04030201>\n")
+                              ? 1
+                              : 0;
+    std::cout << "    Errors: unknown " << stats.unknown << ", malformed "
+              << stats.malformed << " (failures " << failures << ")\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t records = (argc > 1) ? std::stoi(argv[1]) : 100000;
+
+    std::cout << "  Records: " << records << "\n\n";
+
+    run_test(records, "test18.log");
+    run_errors();
+}
@@ -0,0 +1,180 @@
+#include "format.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+
+// values around every power of 10 and of 16 and random ones of all lengths
+auto test_values(uint32_t count) -> std::vector<uint64_t> {
+    std::vector<uint64_t> values{0, 1, 9, 10, 99, 100, UINT64_MAX};
+    for (auto p = 10ull, i = 1ull; i < 20; p *= 10, ++i) {
+        values.insert(values.end(), {p - 1, p, p + 1});
+    }
+    for (auto shift = 4u; shift < 64; shift += 4) {
+        auto const p = 1ull << shift;
+        values.insert(values.end(), {p - 1, p, p + 1});
+    }
+    std::mt19937_64 random(19);
+    for (auto i = 0u; i < count; ++i) {
+        values.push_back(random() >> (random() % 64));
+    }
+    return values;
+}
+
+// formatting matches snprintf
+void verify(std::vector<uint64_t> const& values) {
+    auto failures = 0ull;
+    char expected[64];
+    char out[64];
+    for (auto v : values) {
+        auto n = std::snprintf(expected, sizeof(expected), "%llu",
+                               static_cast<unsigned long long>(v));
+        if (kernel::format::digits(v) != uint32_t(n) ||
+            kernel::format::dec(out, v) != uint32_t(n) ||
+            memcmp(out, expected, n)) {
+            ++failures;
+        }
+
+        auto const s = int64_t(v);
+        n = std::snprintf(expected, sizeof(expected), "%lld",
+                          static_cast<long long>(s));
+        if (kernel::format::dec_signed(out, s) != uint32_t(n) ||
+            memcmp(out, expected, n)) {
+            ++failures;
+        }
+
+        std::snprintf(expected, sizeof(expected), "%016llX",
+                      static_cast<unsigned long long>(v));
+        kernel::format::hex(out, v);
+        if (memcmp(out, expected, 16)) {
+            ++failures;
+        }
+    }
+
+    // format strings, and truncation at every capacity
+    auto const full = std::string("core 3 delta -42 at 0000000000001000 on "
+                                  "cpu0.");
+    for (auto capacity = 0u; capacity <= full.size() + 8; ++capacity) {
+        memset(out, '#', sizeof(out));
+        auto const n = kernel::format::to(out, capacity,
+                                          "core {} delta {i} at {x} on {s}.",
+                                          3u, -42, 4096ull, "cpu0");
+        auto const want = capacity < full.size() ? capacity : full.size();
+        if (n != want || memcmp(out, full.data(), n) || out[n] != '#') {
+            ++failures;
+        }
+    }
+    auto const n = kernel::format::to(out, sizeof(out), "no arguments");
+    if (std::string(out, n) != "no arguments") {
+        ++failures;
+    }
+
+    std::cout << "    Verified: " << values.size() << " values (failures "
+              << failures << ")\n\n";
+}
+
+// the replaced formatting: one division per digit and a lookup per nibble
+auto dec_per_digit(char* out, uint64_t value) -> uint32_t {
+    char digits[20];
+    auto i = 0u;
+    do {
+        digits[i++] = char('0' + value % 10);
+        value /= 10;
+    } while (value);
+    auto n = 0u;
+    while (i > 0) {
+        out[n++] = digits[--i];
+    }
+    return n;
+}
+
+auto hex_per_nibble(char* out, uint64_t value) -> void {
+    char constexpr static hex_chars[] = "0123456789ABCDEF";
+    for (auto i = 0; i < 16; ++i) {
+        out[i] = hex_chars[(value >> (60 - 4 * i)) & 0xf];
+    }
+}
+
+template <typename F>
+auto time_ns(std::vector<uint64_t> const& values, uint32_t rounds, F f)
+    -> double {
+    auto sink = 0ull;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto r = 0u; r < rounds; ++r) {
+        for (auto v : values) {
+            sink += f(v);
+        }
+    }
+    std::chrono::duration<double> diff =
+        std::chrono::high_resolution_clock::now() - start_time;
+    asm volatile("" : : "r"(sink));
+    return diff.count() * 1e9 / (double(values.size()) * rounds);
+}
+
+void run_benchmark(std::vector<uint64_t> const& values, uint32_t rounds,
+                   char const* label) {
+    char out[64];
+    auto const per_digit = time_ns(values, rounds, [&](uint64_t v) {
+        auto const n = dec_per_digit(out, v);
+        asm volatile("" : : "r"(out) : "memory");
+        return n;
+    });
+    auto const pairs = time_ns(values, rounds, [&](uint64_t v) {
+        auto const n = kernel::format::dec(out, v);
+        asm volatile("" : : "r"(out) : "memory");
+        return n;
+    });
+    auto const per_nibble = time_ns(values, rounds, [&](uint64_t v) {
+        hex_per_nibble(out, v);
+        asm volatile("" : : "r"(out) : "memory");
+        return 16u;
+    });
+    auto const vector = time_ns(values, rounds, [&](uint64_t v) {
+        kernel::format::hex(out, v);
+        asm volatile("" : : "r"(out) : "memory");
+        return 16u;
+    });
+    auto const snprintf = time_ns(values, rounds, [&](uint64_t v) {
+        return uint32_t(std::snprintf(out, sizeof(out), "%llu at %016llX\n",
+                                      static_cast<unsigned long long>(v),
+                                      static_cast<unsigned long long>(v)));
+    });
+    auto const format = time_ns(values, rounds, [&](uint64_t v) {
+        auto const n = kernel::format::to(out, sizeof(out), "{} at {x}\n", v, v);
+        asm volatile("" : : "r"(out) : "memory");
+        return n;
+    });
+
+    std::cout << "Results for " << label << " values (ns per value):\n";
+    std::cout << "     Decimal: " << per_digit << " per digit, " << pairs
+              << " pairs\n";
+    std::cout << "         Hex: " << per_nibble << " per nibble, " << vector
+              << " vector\n";
+    std::cout << "      Format: " << snprintf << " snprintf, " << format
+              << " format::to\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = (argc > 1) ? std::stoi(argv[1]) : 10000;
+    uint32_t rounds = (argc > 2) ? std::stoi(argv[2]) : 100;
+
+    std::cout << "  Values: " << count << "\n";
+    std::cout << "  Rounds: " << rounds << "\n\n";
+
+    auto const values = test_values(count);
+    verify(values);
+
+    // small values as in status output, and all lengths
+    std::vector<uint64_t> small;
+    std::mt19937_64 random(42);
+    for (auto i = 0u; i < count; ++i) {
+        small.push_back(random() % 10000);
+    }
+    run_benchmark(small, rounds, "small");
+    run_benchmark(values, rounds, "all length");
+}
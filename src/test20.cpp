@@ -0,0 +1,163 @@
+#include "graphics.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+
+using kernel::graphics::BackBuffer;
+using kernel::graphics::Rect;
+
+// frame buffer of plain memory with a stride wider than the width as on
+// real hardware
+struct Screen {
+    std::vector<uint32_t> memory;
+    kernel::FrameBuffer frame_buffer;
+
+    Screen(uint32_t width, uint32_t height)
+        : memory(uint64_t(width + 64) * height + 16) {
+        // 4 byte aligned only, as the stores of `present` must handle
+        frame_buffer = {memory.data() + 1, width, height, width + 64};
+    }
+};
+
+struct Buffer {
+    void* memory;
+    BackBuffer back;
+
+    Buffer(uint32_t width, uint32_t height)
+        : memory(std::aligned_alloc(64, BackBuffer::size_of(width, height))) {
+        back.init(memory, width, height);
+    }
+    ~Buffer() { std::free(memory); }
+};
+
+// draws random rectangles for some frames presenting each and checks that
+// the dirty rectangles lie inside the buffer and that the frame buffer
+// matches the back buffer
+void verify(uint32_t width, uint32_t height, uint32_t frames, bool avx) {
+    kernel::cpu::features.avx = avx;
+    Screen screen(width, height);
+    Buffer buffer(width, height);
+    auto& back = buffer.back;
+
+    // same start on both
+    back.fill(back.bounds(), 0);
+    back.present(screen.frame_buffer);
+
+    std::mt19937 random(20);
+    auto failures = 0ull;
+    auto copied = 0ull;
+    for (auto f = 0u; f < frames; ++f) {
+        auto const rects = 1 + random() % 40;
+        for (auto r = 0u; r < rects; ++r) {
+            auto const x = uint32_t(random() % (width + 20));
+            auto const y = uint32_t(random() % (height + 20));
+            auto const w = uint32_t(1 + random() % 100);
+            auto const h = uint32_t(1 + random() % 40);
+            back.fill({x, y, x + w, y + h}, uint32_t(random()));
+        }
+
+        // each dirty rectangle inside the buffer
+        for (auto i = 0u; i < back.dirty_count(); ++i) {
+            auto const d = back.dirty(i);
+            if (d.empty() || d.right > width || d.bottom > height) {
+                ++failures;
+            }
+        }
+
+        copied += back.present(screen.frame_buffer);
+        for (auto y = 0u; y < height; ++y) {
+            for (auto x = 0u; x < width; ++x) {
+                auto const p =
+                    screen.frame_buffer.pixels[y * screen.frame_buffer.stride +
+                                               x];
+                if (p != back.row(y)[x]) {
+                    ++failures;
+                }
+            }
+        }
+    }
+
+    std::cout << "    Verified " << (avx ? "avx" : "sse") << ": " << frames
+              << " frames, " << (copied / frames) << " pixels per present "
+              << "(failures " << failures << ")\n";
+}
+
+// frame of a status display: a moving cursor, a text line and a clock
+void draw_status(BackBuffer& back, uint32_t f) {
+    auto const x = (f * 7) % (back.width() - 16);
+    auto const y = (f * 3) % (back.height() - 16);
+    back.fill({x, y, x + 16, y + 16}, 0xffffff);
+    back.fill({20, 40 + (f % 50) * 16, 620, 56 + (f % 50) * 16}, f);
+    back.fill({back.width() - 120, 8, back.width() - 20, 24}, f * 3);
+}
+
+template <typename F> auto time_frame(uint32_t frames, F f) -> double {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto i = 0u; i < frames; ++i) {
+        f(i);
+    }
+    std::chrono::duration<double> diff =
+        std::chrono::high_resolution_clock::now() - start_time;
+    return diff.count() * 1e6 / frames;
+}
+
+void run_benchmark(uint32_t width, uint32_t height, uint32_t frames) {
+    Screen screen(width, height);
+    Buffer buffer(width, height);
+    auto& back = buffer.back;
+    back.fill(back.bounds(), 0);
+    back.present(screen.frame_buffer);
+
+    // only the dirty rectangles
+    auto const dirty = time_frame(frames, [&](uint32_t f) {
+        draw_status(back, f);
+        back.present(screen.frame_buffer);
+    });
+
+    // the whole frame each time
+    auto const full = time_frame(frames, [&](uint32_t f) {
+        draw_status(back, f);
+        back.mark_all();
+        back.present(screen.frame_buffer);
+    });
+
+    // drawing straight into the frame buffer
+    auto const direct = time_frame(frames, [&](uint32_t f) {
+        BackBuffer target;
+        target.init(screen.frame_buffer.pixels, width, height);
+        draw_status(target, f);
+    });
+
+    std::cout << "Results for " << width << "x" << height
+              << " status frames (us per frame):\n";
+    std::cout << "      Dirty: " << dirty << "\n";
+    std::cout << "       Full: " << full << "\n";
+    std::cout << "     Direct: " << direct
+              << " (host memory, not write-combined)\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t width = (argc > 1) ? std::stoi(argv[1]) : 1920;
+    uint32_t height = (argc > 2) ? std::stoi(argv[2]) : 1080;
+    uint32_t frames = (argc > 3) ? std::stoi(argv[3]) : 200;
+
+    std::cout << "  Resolution: " << width << "x" << height << "\n";
+    std::cout << "      Frames: " << frames << "\n\n";
+
+    kernel::cpu::init();
+    auto const avx = kernel::cpu::features.avx;
+    verify(317, 203, 50, false);
+    if (avx) {
+        verify(317, 203, 50, true);
+    }
+    kernel::cpu::features.avx = avx;
+    std::cout << "\n";
+
+    run_benchmark(width, height, frames);
+}
@@ -0,0 +1,171 @@
+#include "osca.hpp"
+#include "render.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+using kernel::graphics::BackBuffer;
+using kernel::graphics::Rect;
+
+struct Buffer {
+    void* memory;
+    BackBuffer back;
+
+    Buffer(uint32_t width, uint32_t height)
+        : memory(std::aligned_alloc(64, BackBuffer::size_of(width, height))) {
+        back.init(memory, width, height);
+    }
+    ~Buffer() { std::free(memory); }
+};
+
+// random rectangle of up to `size` pixels a side, partly off screen at times
+auto random_rect(std::mt19937& random, uint32_t width, uint32_t height,
+                 uint32_t size) -> Rect {
+    auto const x = uint32_t(random() % width);
+    auto const y = uint32_t(random() % height);
+    auto const w = uint32_t(1 + random() % size);
+    auto const h = uint32_t(1 + random() % size);
+    return {x, y, x + w, y + h};
+}
+
+// frame `frame` of a synthetic scene as calls of `fill(rect, color)` and
+// `blend(rect, color)`
+// note: desktop has large opaque windows and translucent panels, particles
+//       many small translucent squares
+template <typename Fill, typename Blend>
+void scene(bool particles, uint32_t width, uint32_t height, uint32_t frame,
+           Fill fill, Blend blend) {
+    std::mt19937 random(frame);
+    fill(Rect{0, 0, width, height}, 0x00203040 + frame);
+    if (particles) {
+        for (auto i = 0u; i < 3000; ++i) {
+            blend(random_rect(random, width, height, 12), uint32_t(random()));
+        }
+        return;
+    }
+    for (auto i = 0u; i < 40; ++i) {
+        fill(random_rect(random, width, height, 600),
+             uint32_t(random()) & 0xffffff);
+    }
+    for (auto i = 0u; i < 60; ++i) {
+        blend(random_rect(random, width, height, 400), uint32_t(random()));
+    }
+}
+
+// records frame `frame` on the renderer
+void record(bool particles, uint32_t width, uint32_t height, uint32_t frame) {
+    osca::renderer.begin();
+    scene(
+        particles, width, height, frame,
+        [](Rect r, uint32_t c) { osca::renderer.fill(r, c); },
+        [](Rect r, uint32_t c) { osca::renderer.blend(r, c); });
+}
+
+// draws frame `frame` on one core without tiles
+void draw(bool particles, BackBuffer& back, uint32_t frame) {
+    auto const target = back.surface();
+    scene(
+        particles, back.width(), back.height(), frame,
+        [&](Rect r, uint32_t c) { kernel::graphics::fill_rect(target, r, c); },
+        [&](Rect r, uint32_t c) {
+            kernel::graphics::blend_rect(target, r, c);
+        });
+}
+
+// renders `frames` frames of a scene with `consumers` helping and checks the
+// last one against drawing it on one core without tiles
+void run_test(uint32_t consumers, bool particles, uint32_t frames,
+              BackBuffer& back, BackBuffer& reference) {
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // caller core index is after consumers
+    current_core = consumers;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto f = 0u; f < frames; ++f) {
+        record(particles, back.width(), back.height(), f);
+        osca::renderer.render(back, osca::jobs, consumers + 1);
+    }
+    std::chrono::duration<double> diff =
+        std::chrono::high_resolution_clock::now() - start_time;
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    auto failures = 0ull;
+    draw(particles, reference, frames - 1);
+    for (auto y = 0u; y < back.height(); ++y) {
+        for (auto x = 0u; x < back.width(); ++x) {
+            failures += back.row(y)[x] != reference.row(y)[x];
+        }
+    }
+    // the background covers the frame
+    failures += back.dirty_count() != 1 ||
+                back.dirty(0).area() != back.bounds().area();
+    back.present(reference.surface());
+
+    std::cout << "Results for " << consumers << "C + caller:\n";
+    std::cout << "     Frame: " << (diff.count() * 1e3 / frames) << " ms\n";
+    std::cout << "  Failures: " << failures << "\n\n";
+}
+
+// frame time of drawing on one core without tiles
+void run_single(bool particles, uint32_t frames, BackBuffer& back) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (auto f = 0u; f < frames; ++f) {
+        draw(particles, back, f);
+    }
+    std::chrono::duration<double> diff =
+        std::chrono::high_resolution_clock::now() - start_time;
+
+    std::cout << "Results for one core without tiles:\n";
+    std::cout << "     Frame: " << (diff.count() * 1e3 / frames) << " ms\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t max_consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t frames = (argc > 2) ? std::stoi(argv[2]) : 20;
+    uint32_t width = (argc > 3) ? std::stoi(argv[3]) : 1920;
+    uint32_t height = (argc > 4) ? std::stoi(argv[4]) : 1080;
+
+    std::cout << " Consumers: 0 to " << max_consumers << "\n";
+    std::cout << "    Frames: " << frames << "\n";
+    std::cout << "Resolution: " << width << "x" << height << "\n\n";
+
+    kernel::cpu::init();
+    osca::jobs.init();
+
+    Buffer buffer(width, height);
+    Buffer reference(width, height);
+
+    for (auto particles : {false, true}) {
+        std::cout << "Scene: " << (particles ? "particles" : "desktop")
+                  << "\n\n";
+        run_single(particles, frames, reference.back);
+        for (auto consumers = 0u; consumers <= max_consumers;
+             consumers = consumers ? consumers * 2 : 1) {
+            run_test(consumers, particles, frames, buffer.back,
+                     reference.back);
+        }
+    }
+}
@@ -0,0 +1,297 @@
+#include "graphics.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test.hpp"
+
+using kernel::FrameBuffer;
+using kernel::graphics::Rect;
+
+// frame buffer of plain memory with a stride wider than the width
+struct Surface {
+    std::vector<uint32_t> memory;
+    FrameBuffer fb;
+
+    Surface(uint32_t width, uint32_t height)
+        : memory(uint64_t(width + 8) * height + 8) {
+        fb = {memory.data() + 1, width, height, width + 8};
+    }
+
+    auto at(uint32_t x, uint32_t y) -> uint32_t& {
+        return fb.pixels[uint64_t(y) * fb.stride + x];
+    }
+};
+
+void randomize(Surface& s, std::mt19937& random) {
+    for (auto& p : s.memory) {
+        p = uint32_t(random());
+    }
+}
+
+//
+// references, one pixel at a time
+//
+
+void fill_reference(Surface& t, Rect r, uint32_t color) {
+    for (auto y = r.top; y < r.bottom && y < t.fb.height; ++y) {
+        for (auto x = r.left; x < r.right && x < t.fb.width; ++x) {
+            t.at(x, y) = color;
+        }
+    }
+}
+
+void blend_reference(Surface& t, Rect r, uint32_t color) {
+    for (auto y = r.top; y < r.bottom && y < t.fb.height; ++y) {
+        for (auto x = r.left; x < r.right && x < t.fb.width; ++x) {
+            t.at(x, y) = kernel::graphics::blend(t.at(x, y), color);
+        }
+    }
+}
+
+void blit_reference(Surface& t, int32_t x, int32_t y, Surface& s, Rect r,
+                    bool blend) {
+    for (auto sy = r.top; sy < r.bottom && sy < s.fb.height; ++sy) {
+        for (auto sx = r.left; sx < r.right && sx < s.fb.width; ++sx) {
+            auto const tx = int64_t(x) + sx - r.left;
+            auto const ty = int64_t(y) + sy - r.top;
+            if (tx < 0 || ty < 0 || tx >= t.fb.width || ty >= t.fb.height) {
+                continue;
+            }
+            auto& p = t.at(uint32_t(tx), uint32_t(ty));
+            p = blend ? kernel::graphics::blend(p, s.at(sx, sy)) : s.at(sx, sy);
+        }
+    }
+}
+
+// scales all of `s` to `r`, which lies inside `t`
+void nearest_reference(Surface& t, Rect r, Surface& s) {
+    auto const w = r.right - r.left;
+    auto const h = r.bottom - r.top;
+    auto const step_x = uint32_t((uint64_t(s.fb.width) << 16) / w);
+    auto const step_y = uint32_t((uint64_t(s.fb.height) << 16) / h);
+    for (auto y = 0u; y < h; ++y) {
+        for (auto x = 0u; x < w; ++x) {
+            t.at(r.left + x, r.top + y) = s.at((step_x / 2 + x * step_x) >> 16,
+                                               (step_y / 2 + y * step_y) >> 16);
+        }
+    }
+}
+
+void bilinear_reference(Surface& t, Rect r, Surface& s) {
+    auto const w = r.right - r.left;
+    auto const h = r.bottom - r.top;
+    auto const step_x = int64_t((uint64_t(s.fb.width) << 16) / w);
+    auto const step_y = int64_t((uint64_t(s.fb.height) << 16) / h);
+    for (auto y = 0u; y < h; ++y) {
+        auto const sy = kernel::graphics::sample_at(
+            step_y / 2 - 0x8000 + y * step_y, s.fb.height);
+        for (auto x = 0u; x < w; ++x) {
+            auto const sx = kernel::graphics::sample_at(
+                step_x / 2 - 0x8000 + x * step_x, s.fb.width);
+            auto pixel = 0u;
+            for (auto shift = 0u; shift < 32; shift += 8) {
+                auto const c = [&](uint32_t px, uint32_t py) {
+                    return (s.at(px, py) >> shift) & 0xff;
+                };
+                auto const top = (c(sx.x, sy.x) * (256 - sx.weight) +
+                                  c(sx.x + 1, sy.x) * sx.weight) >>
+                                 8;
+                auto const bottom = (c(sx.x, sy.x + 1) * (256 - sx.weight) +
+                                     c(sx.x + 1, sy.x + 1) * sx.weight) >>
+                                    8;
+                pixel |= ((top * (256 - sy.weight) + bottom * sy.weight) >> 8)
+                         << shift;
+            }
+            t.at(r.left + x, r.top + y) = pixel;
+        }
+    }
+}
+
+// draws random primitives with the current vector path and the references
+// and compares the targets
+void verify(char const* label, uint32_t rounds) {
+    std::mt19937 random(22);
+    Surface t(203, 117), e(203, 117), s(90, 70);
+    auto failures = 0ull;
+
+    auto const check = [&] {
+        failures += t.memory != e.memory;
+        e.memory = t.memory;
+    };
+    randomize(t, random);
+    e.memory = t.memory;
+    randomize(s, random);
+
+    for (auto r = 0u; r < rounds; ++r) {
+        auto const x = uint32_t(random() % 220);
+        auto const y = uint32_t(random() % 130);
+        auto const rect = Rect{x, y, x + uint32_t(random() % 80),
+                               y + uint32_t(random() % 50)};
+        auto const color = uint32_t(random());
+
+        kernel::graphics::fill_rect(t.fb, rect, color);
+        fill_reference(e, rect, color);
+        check();
+
+        kernel::graphics::blend_rect(t.fb, rect, color);
+        blend_reference(e, rect, color);
+        check();
+
+        auto const sx = uint32_t(random() % 100);
+        auto const sy = uint32_t(random() % 80);
+        auto const source = Rect{sx, sy, sx + uint32_t(random() % 100),
+                                 sy + uint32_t(random() % 80)};
+        auto const bx = int32_t(random() % 260) - 40;
+        auto const by = int32_t(random() % 160) - 30;
+        kernel::graphics::blit(t.fb, bx, by, s.fb, source);
+        blit_reference(e, bx, by, s, source, false);
+        check();
+
+        kernel::graphics::blit_blend(t.fb, bx, by, s.fb, source);
+        blit_reference(e, bx, by, s, source, true);
+        check();
+
+        // up and down scaling of the whole source inside the target
+        auto const w = 1 + uint32_t(random() % 200);
+        auto const h = 1 + uint32_t(random() % 110);
+        auto const tx = uint32_t(random() % (203 - w + 1));
+        auto const ty = uint32_t(random() % (117 - h + 1));
+        auto const target = Rect{tx, ty, tx + w, ty + h};
+        kernel::graphics::scale_nearest(t.fb, target, s.fb,
+                                        Rect{0, 0, 90, 70});
+        nearest_reference(e, target, s);
+        check();
+
+        kernel::graphics::scale_bilinear(t.fb, target, s.fb,
+                                         Rect{0, 0, 90, 70});
+        bilinear_reference(e, target, s);
+        check();
+    }
+
+    std::cout << "    Verified " << label << ": " << rounds
+              << " rounds of 6 primitives (failures " << failures << ")\n";
+}
+
+// returns pixels per tsc cycle of `f` drawing `pixels` pixels
+template <typename F> auto rate(uint64_t pixels, uint32_t rounds, F f)
+    -> double {
+    f();
+    auto const start = kernel::core::rdtsc();
+    for (auto r = 0u; r < rounds; ++r) {
+        f();
+    }
+    auto const cycles = kernel::core::rdtsc() - start;
+    return double(pixels) * rounds / double(cycles);
+}
+
+void run_benchmark(char const* label, uint32_t width, uint32_t height,
+                   uint32_t rounds) {
+    std::mt19937 random(7);
+    Surface t(width, height), e(width, height);
+    Surface s(width / 2, height / 2);
+    randomize(s, random);
+    auto const all = Rect{0, 0, width, height};
+    auto const tile = Rect{0, 0, 256, 256};
+    auto const pixels = uint64_t(width) * height;
+
+    std::cout << "Results for " << label << " (pixels per cycle):\n";
+    std::cout << "     Fill tile: "
+              << rate(256 * 256, rounds * 20,
+                      [&] { kernel::graphics::fill_rect(t.fb, tile, 1); })
+              << "\n";
+    std::cout << "   Fill screen: "
+              << rate(pixels, rounds,
+                      [&] { kernel::graphics::fill_rect(t.fb, all, 2); })
+              << "\n";
+    std::cout << "         Blend: "
+              << rate(pixels, rounds,
+                      [&] {
+                          kernel::graphics::blend_rect(t.fb, all, 0x80ff8040);
+                      })
+              << "\n";
+    std::cout << "          Blit: "
+              << rate(pixels / 4, rounds,
+                      [&] {
+                          kernel::graphics::blit(t.fb, 10, 10, s.fb,
+                                                 Rect{0, 0, width, height});
+                      })
+              << "\n";
+    std::cout << "    Blit blend: "
+              << rate(pixels / 4, rounds,
+                      [&] {
+                          kernel::graphics::blit_blend(
+                              t.fb, 10, 10, s.fb, Rect{0, 0, width, height});
+                      })
+              << "\n";
+    std::cout << " Scale nearest: "
+              << rate(pixels, rounds,
+                      [&] {
+                          kernel::graphics::scale_nearest(
+                              t.fb, all, s.fb, Rect{0, 0, width, height});
+                      })
+              << "\n";
+    std::cout << "Scale bilinear: "
+              << rate(pixels, rounds,
+                      [&] {
+                          kernel::graphics::scale_bilinear(
+                              t.fb, all, s.fb, Rect{0, 0, width, height});
+                      })
+              << "\n\n";
+}
+
+// the per-pixel loops the vector paths replace
+void run_reference(uint32_t width, uint32_t height, uint32_t rounds) {
+    std::mt19937 random(7);
+    Surface t(width, height), s(width / 2, height / 2);
+    randomize(s, random);
+    auto const all = Rect{0, 0, width, height};
+    auto const pixels = uint64_t(width) * height;
+
+    std::cout << "Results for per-pixel loops (pixels per cycle):\n";
+    std::cout << "   Fill screen: "
+              << rate(pixels, rounds, [&] { fill_reference(t, all, 2); })
+              << "\n";
+    std::cout << "         Blend: "
+              << rate(pixels, rounds,
+                      [&] { blend_reference(t, all, 0x80ff8040); })
+              << "\n";
+    std::cout << " Scale nearest: "
+              << rate(pixels, rounds, [&] { nearest_reference(t, all, s); })
+              << "\n";
+    std::cout << "Scale bilinear: "
+              << rate(pixels, rounds, [&] { bilinear_reference(t, all, s); })
+              << "\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t width = (argc > 1) ? std::stoi(argv[1]) : 1920;
+    uint32_t height = (argc > 2) ? std::stoi(argv[2]) : 1080;
+    uint32_t rounds = (argc > 3) ? std::stoi(argv[3]) : 20;
+
+    std::cout << "  Resolution: " << width << "x" << height << "\n";
+    std::cout << "      Rounds: " << rounds << "\n\n";
+
+    kernel::cpu::init();
+    auto const features = kernel::cpu::features;
+
+    // baseline sse2 paths, then avx and avx2 if supported
+    kernel::cpu::features = {};
+    verify("sse2", 300);
+    kernel::cpu::features = features;
+    if (features.avx2) {
+        verify("avx2", 300);
+    }
+    std::cout << "\n";
+
+    run_reference(width, height, rounds);
+    kernel::cpu::features = {};
+    run_benchmark("sse2", width, height, rounds);
+    kernel::cpu::features = features;
+    if (features.avx2) {
+        run_benchmark("avx2", width, height, rounds);
+    }
+}
@@ -0,0 +1,146 @@
+#include "osca.hpp"
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// job that counts its runs and its destruction
+struct Probe {
+    std::atomic<uint64_t>* ran;
+    std::atomic<uint64_t>* destroyed;
+
+    void run() { ran->fetch_add(1, std::memory_order_relaxed); }
+
+    ~Probe() { destroyed->fetch_add(1, std::memory_order_relaxed); }
+};
+
+osca::queue::Spmc<16> spmc;
+osca::queue::Mpmc<16> mpmc;
+
+// cancels single jobs before and after they are claimed, with stale handles
+// and with handles of failed adds
+template <typename Queue>
+auto verify(char const* const name, Queue& queue) -> uint64_t {
+    std::atomic<uint64_t> ran{0};
+    std::atomic<uint64_t> destroyed{0};
+    auto failures = 0ull;
+
+    queue.init();
+
+    // cancelled before claim: destroyed without running
+    auto const pending =
+        queue.template add_cancellable<Probe>(&ran, &destroyed);
+    failures += !queue.cancel(pending);
+    failures += queue.cancel(pending);
+    failures += queue.run_next();
+    failures += ran.load() != 0 || destroyed.load() != 1;
+
+    // cancelled after claim: has run
+    auto const claimed =
+        queue.template add_cancellable<Probe>(&ran, &destroyed);
+    failures += !queue.run_next();
+    failures += queue.cancel(claimed);
+    failures += ran.load() != 1 || destroyed.load() != 2;
+
+    // stale: the handle's slot holds a job of a later lap
+    auto const stale =
+        queue.template add_cancellable<Probe>(&ran, &destroyed);
+    failures += !queue.run_next();
+    for (auto i = 0u; i < 15; ++i) {
+        queue.template add_cancellable<Probe>(&ran, &destroyed);
+        failures += !queue.run_next();
+    }
+    auto const reused =
+        queue.template add_cancellable<Probe>(&ran, &destroyed);
+    failures += reused.slot != stale.slot;
+    failures += queue.cancel(stale);
+    failures += !queue.run_next();
+    failures += ran.load() != 18 || destroyed.load() != 19;
+
+    // failed add and default handle: no entry is touched
+    for (auto i = 0u; i < 16; ++i) {
+        queue.template add_cancellable<Probe>(&ran, &destroyed);
+    }
+    auto const failed =
+        queue.template try_add_cancellable<Probe>(&ran, &destroyed);
+    failures += bool(failed);
+    failures += queue.cancel(failed);
+    failures += queue.cancel(typename Queue::Handle{16, 0});
+    while (queue.run_next()) {
+    }
+    failures += ran.load() != 34 || destroyed.load() != 35;
+
+    std::cout << "  " << name << ": ran " << ran.load() << ", destroyed "
+              << destroyed.load() << " (failures " << failures << ")\n";
+    return failures;
+}
+
+// cancels jobs while consumers run them; each job either runs or is cancelled,
+// never both
+template <typename Queue>
+auto race(char const* const name, Queue& queue, uint32_t consumers,
+          uint32_t count) -> uint64_t {
+    std::atomic<uint64_t> ran{0};
+    std::atomic<uint64_t> destroyed{0};
+
+    queue.init();
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i, &queue](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!queue.run_next()) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    // cancels the job added 8 adds earlier, which consumers may have claimed
+    typename Queue::Handle handles[8];
+    auto cancelled = 0ull;
+    for (auto i = 0u; i < count; ++i) {
+        auto& handle = handles[i % 8];
+        if (i >= 8) {
+            cancelled += queue.cancel(handle);
+        }
+        handle = queue.template add_cancellable<Probe>(&ran, &destroyed);
+    }
+
+    queue.wait_idle();
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+    consumer_threads.clear();
+
+    auto const failures =
+        uint64_t(ran.load() + cancelled != count || destroyed.load() != count);
+    std::cout << "  " << name << " / " << consumers << "C: ran " << ran.load()
+              << ", cancelled " << cancelled << " of " << count
+              << " (failures " << failures << ")\n";
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t count = (argc > 2) ? std::stoi(argv[2]) : 100000;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "     Jobs: " << count << "\n\n";
+
+    auto failures = 0ull;
+    failures += verify("spmc", spmc);
+    failures += verify("mpmc", mpmc);
+    failures += race("spmc", spmc, consumers, count);
+    failures += race("mpmc", mpmc, consumers, count);
+
+    return failures != 0;
+}
@@ -0,0 +1,158 @@
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// job of varying length that records when it finished relative to others
+// note: with `successor` set, the job holds its consumer for up to a
+//       millisecond until the next job has finished, so jobs complete out of
+//       order whenever another consumer is free
+struct Step {
+    uint64_t work;
+    std::atomic<uint64_t>* order;
+    std::atomic<uint64_t>* finished_at;
+    std::atomic<uint64_t>* successor;
+
+    void run() {
+        auto val = work;
+        for (auto i = 0u; i < work; ++i) {
+            val = ((val << 5) + val) + i;
+        }
+
+        // tells the compiler 'val' is used here, don't optimize it away
+        asm volatile("" : : "g"(val) : "memory");
+
+        if (successor) {
+            auto const until = std::chrono::steady_clock::now() +
+                               std::chrono::milliseconds(1);
+            while (successor->load(std::memory_order_relaxed) == 0 &&
+                   std::chrono::steady_clock::now() < until) {
+                std::this_thread::yield();
+            }
+        }
+
+        finished_at->store(order->fetch_add(1, std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+    }
+};
+
+osca::queue::Mpmc<64> queue;
+
+// each producer adds jobs of random length, every 4th held until the next one
+// finished, and waits for the ticket of the job it added `lag` jobs earlier,
+// then checks that its jobs up to that one have finished although later jobs
+// of any producer may have finished first
+auto run_test(uint32_t consumers, uint32_t producers, uint32_t count,
+              uint32_t lag, uint64_t max_work) -> uint64_t {
+    std::atomic<uint64_t> order{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> inversions{0};
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!queue.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // producer core indexes are after consumers
+    std::vector<std::thread> producer_threads;
+    for (auto p = 0u; p < producers; ++p) {
+        producer_threads.emplace_back([&, p] {
+            current_core = consumers + p;
+
+            std::vector<std::atomic<uint64_t>> finished_at(count);
+            std::vector<uint32_t> tickets(count);
+            auto rng = 12345u + p;
+            auto verified = 0u;
+
+            auto const verify = [&](uint32_t const end) {
+                for (; verified < end; ++verified) {
+                    auto const at =
+                        finished_at[verified].load(std::memory_order_relaxed);
+                    failures += at == 0;
+                    // a later job of this producer finished first
+                    inversions += verified + 1 < count &&
+                                  at > finished_at[verified + 1].load(
+                                           std::memory_order_relaxed) &&
+                                  finished_at[verified + 1].load(
+                                      std::memory_order_relaxed) != 0;
+                }
+            };
+
+            for (auto i = 0u; i < count; ++i) {
+                rng = rng * 1664525 + 1013904223;
+                auto const work = (rng >> 8) % max_work;
+                auto* const successor =
+                    i % 4 == 0 && i + 1 < count ? &finished_at[i + 1] : nullptr;
+                tickets[i] =
+                    queue.add<Step>(work, &order, &finished_at[i], successor)
+                        .generation;
+
+                if (i >= lag) {
+                    auto const ticket = tickets[i - lag];
+                    queue.wait_until(ticket);
+                    failures += !queue.done(ticket);
+                    verify(i - lag + 1);
+                }
+            }
+
+            queue.wait_until(tickets[count - 1]);
+            verify(count);
+        });
+    }
+
+    for (auto& p : producer_threads) {
+        p.join();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end_time - start_time;
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    std::cout << "Results for " << producers << "P / " << consumers << "C:\n";
+    std::cout << "   Elapsed: " << elapsed.count() << " ms\n";
+    std::cout << "  Finished: " << order.load() << " / "
+              << uint64_t(producers) * count << "\n";
+    std::cout << "  Reversed: " << inversions.load()
+              << " neighbouring jobs finished out of order\n";
+    std::cout << "  Verified: " << (failures.load() == 0 ? "yes" : "no")
+              << " (failures " << failures.load() << ")\n\n";
+    return failures.load();
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t producers = (argc > 2) ? std::stoi(argv[2]) : 3;
+    uint32_t count = (argc > 3) ? std::stoi(argv[3]) : 4000;
+    uint32_t lag = (argc > 4) ? std::stoi(argv[4]) : 8;
+    uint64_t max_work = (argc > 5) ? std::stoull(argv[5]) : 2000;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "Producers: " << producers << "\n";
+    std::cout << "     Jobs: " << count << " per producer\n";
+    std::cout << "      Lag: " << lag << "\n";
+    std::cout << " Max work: " << max_work << "\n\n";
+
+    queue.init();
+
+    auto failures = run_test(consumers, 1, count, lag, max_work);
+    failures += run_test(consumers, producers, count, lag, max_work);
+    return failures != 0;
+}
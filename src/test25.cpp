@@ -0,0 +1,104 @@
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "test.hpp"
+
+osca::queue::Spmc<8> spmc;
+osca::queue::Mpmc<8> mpmc;
+
+// rdtsc ticks per microsecond
+uint64_t ticks_per_us() {
+    auto const start = std::chrono::steady_clock::now();
+    auto const t0 = kernel::core::rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto const t1 = kernel::core::rdtsc();
+    std::chrono::duration<double, std::micro> us =
+        std::chrono::steady_clock::now() - start;
+    return uint64_t((t1 - t0) / us.count());
+}
+
+// checks the deadline variants on an empty, a partly filled and a full queue
+// with deadline 0, a passed deadline and a timeout of `wait` ticks, then
+// with the other side arriving within a generous timeout
+template <typename Queue>
+auto verify(char const* const name, Queue& queue, uint64_t const wait)
+    -> uint64_t {
+    std::atomic<uint64_t> ran{0};
+    auto failures = 0ull;
+
+    queue.init();
+
+    // empty queue: nothing to run, timeouts wait at least `wait`
+    failures += queue.run_next_until(0);
+    failures += queue.run_next_until(1);
+    auto t0 = kernel::core::rdtsc();
+    failures += queue.run_next_for(wait);
+    auto const run_waited = kernel::core::rdtsc() - t0;
+    failures += run_waited < wait;
+
+    // free slots: deadlines only matter while the queue is full
+    failures += !queue.template try_add_until<Job>(0, 1u, 10u, &ran);
+    failures += !queue.template try_add_until<Job>(1, 2u, 10u, &ran);
+    failures += !queue.template try_add_for<Job>(0, 3u, 10u, &ran);
+
+    // ready jobs run whatever the deadline
+    failures += !queue.run_next_until(0);
+    failures += !queue.run_next_until(1);
+    failures += !queue.run_next_for(0);
+    failures += ran.load() != 3;
+
+    // full queue: adds fail with deadline 0, a passed deadline and a timeout
+    for (auto i = 0u; i < 8; ++i) {
+        failures += !queue.template try_add<Job>(i, 10u, &ran);
+    }
+    failures += bool(queue.template try_add_until<Job>(0, 0u, 10u, &ran));
+    failures += bool(queue.template try_add_until<Job>(1, 0u, 10u, &ran));
+    t0 = kernel::core::rdtsc();
+    auto const failed = queue.template try_add_for<Job>(wait, 0u, 10u, &ran);
+    auto const add_waited = kernel::core::rdtsc() - t0;
+    failures += bool(failed) || add_waited < wait;
+    failures += queue.active_count() != 8;
+
+    // full queue: a consumer frees a slot before the timeout
+    {
+        std::jthread consumer([&queue] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            queue.run_next();
+        });
+        failures += !queue.template try_add_for<Job>(wait * 1000, 0u, 10u,
+                                                     &ran);
+    }
+    while (queue.run_next()) {
+    }
+    failures += ran.load() != 12;
+
+    // empty queue: a producer adds before the timeout
+    {
+        std::jthread producer([&queue, &ran] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            queue.template add<Job>(0u, 10u, &ran);
+        });
+        failures += !queue.run_next_for(wait * 1000);
+    }
+    failures += ran.load() != 13;
+
+    std::cout << "  " << name << ": run waited " << run_waited
+              << " ticks, add waited " << add_waited << " ticks for " << wait
+              << " (failures " << failures << ")\n";
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    uint64_t wait_us = (argc > 1) ? std::stoull(argv[1]) : 100;
+
+    auto const wait = wait_us * ticks_per_us();
+
+    std::cout << "Timeout: " << wait_us << " us\n\n";
+
+    auto failures = verify("spmc", spmc, wait);
+    failures += verify("mpmc", mpmc, wait);
+    return failures != 0;
+}
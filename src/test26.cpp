@@ -0,0 +1,143 @@
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+osca::queue::Spmc<64> spmc;
+osca::queue::Mpmc<64> mpmc;
+
+// producers hold back while the latest callback was `on_high`
+std::atomic<bool> throttled{false};
+std::atomic<uint64_t> highs{0};
+std::atomic<uint64_t> lows{0};
+// callbacks that did not alternate `on_high`, `on_low`
+std::atomic<uint64_t> misordered{0};
+
+auto on_high(uint32_t) -> void {
+    misordered += throttled.exchange(true);
+    highs.fetch_add(1);
+}
+
+auto on_low(uint32_t) -> void {
+    misordered += !throttled.exchange(false);
+    lows.fetch_add(1);
+}
+
+// producers add short jobs and hold back between `on_high` and `on_low`
+// note: a lost `on_low` leaves producers waiting until `stall_ms` passes and
+//       the queue idle but throttled
+template <typename Queue>
+auto run_test(char const* const name, Queue& queue, uint32_t consumers,
+              uint32_t producers, uint32_t count, uint32_t low, uint32_t high,
+              uint64_t work, uint32_t stall_ms) -> uint64_t {
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> stalls{0};
+
+    queue.init();
+    auto const rejected = !queue.set_watermarks(high, high, on_high, on_low);
+    auto const accepted = queue.set_watermarks(low, high, on_high, on_low);
+    throttled = false;
+    highs = 0;
+    lows = 0;
+    misordered = 0;
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i, &queue](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!queue.run_next()) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // producer core indexes are after consumers
+    std::vector<std::thread> producer_threads;
+    for (auto p = 0u; p < producers; ++p) {
+        producer_threads.emplace_back([&, p] {
+            current_core = consumers + p;
+            for (auto i = 0u; i < count; ++i) {
+                queue.template add<Job>(i, work, &completed);
+
+                auto const until = std::chrono::steady_clock::now() +
+                                   std::chrono::milliseconds(stall_ms);
+                while (throttled.load()) {
+                    if (std::chrono::steady_clock::now() >= until) {
+                        ++stalls;
+                        break;
+                    }
+                    // note: sleeps rather than yields so consumers get the
+                    //       cpu when threads outnumber cores
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+                }
+            }
+        });
+    }
+
+    for (auto& p : producer_threads) {
+        p.join();
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+    queue.wait_idle();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end_time - start_time;
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+    consumer_threads.clear();
+
+    // an idle queue is below `low` so the last `on_high` must have been
+    // followed by `on_low`
+    auto const failures = stalls.load() + (highs.load() != lows.load()) +
+                          (highs.load() == 0) + misordered.load() +
+                          !rejected + !accepted +
+                          (completed.load() != uint64_t(producers) * count);
+
+    std::cout << "Results for " << name << " / " << producers << "P / "
+              << consumers << "C:\n";
+    std::cout << "   Elapsed: " << elapsed.count() << " ms\n";
+    std::cout << "     Highs: " << highs.load() << "\n";
+    std::cout << "      Lows: " << lows.load() << "\n";
+    std::cout << "    Stalls: " << stalls.load() << "\n";
+    std::cout << "Misordered: " << misordered.load() << "\n";
+    std::cout << "  Verified: " << (failures == 0 ? "yes" : "no")
+              << " (failures " << failures << ")\n\n";
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t producers = (argc > 2) ? std::stoi(argv[2]) : 3;
+    uint32_t count = (argc > 3) ? std::stoi(argv[3]) : 100000;
+    uint32_t low = (argc > 4) ? std::stoi(argv[4]) : 3;
+    uint32_t high = (argc > 5) ? std::stoi(argv[5]) : 4;
+    uint64_t work = (argc > 6) ? std::stoull(argv[6]) : 10;
+    uint32_t stall_ms = (argc > 7) ? std::stoi(argv[7]) : 1000;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "Producers: " << producers << " (mpmc)\n";
+    std::cout << "     Jobs: " << count << " per producer\n";
+    std::cout << "      Low: " << low << "\n";
+    std::cout << "     High: " << high << "\n";
+    std::cout << "     Work: " << work << "\n\n";
+
+    auto failures = run_test("spmc", spmc, consumers, 1, count, low, high,
+                             work, stall_ms);
+    failures += run_test("mpmc", mpmc, consumers, producers, count, low, high,
+                         work, stall_ms);
+    return failures != 0;
+}
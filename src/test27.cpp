@@ -0,0 +1,230 @@
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// frame address of the consumer loop, to measure how deep jobs run
+inline thread_local uintptr_t stack_base = 0;
+std::atomic<uint64_t> max_depth{0};
+
+osca::queue::Mpmc<64> queue;
+osca::queue::Costs costs;
+
+// resumable job that continues `left` times with `status` before it is done
+// note: with `filled` set, fills the queue with plain jobs before continuing
+//       so it can only be requeued once the consumer made room
+struct Countdown {
+    uint32_t left;
+    osca::queue::Status status;
+    std::atomic<uint64_t>* runs;
+    std::atomic<uint64_t>* done;
+    std::atomic<uint64_t>* filled;
+
+    auto run() -> osca::queue::Status {
+        auto const depth = stack_base - uintptr_t(__builtin_frame_address(0));
+        auto seen = max_depth.load(std::memory_order_relaxed);
+        while (depth > seen && !max_depth.compare_exchange_weak(seen, depth)) {
+        }
+
+        runs->fetch_add(1, std::memory_order_relaxed);
+        if (--left > 0) {
+            while (filled && queue.try_add<Job>(left, 100u, filled)) {
+            }
+            return status;
+        }
+        done->fetch_add(1, std::memory_order_relaxed);
+        return osca::queue::Status::Done;
+    }
+};
+
+// places a filling countdown in the local slot of the core running it
+struct Starter {
+    uint32_t steps;
+    std::atomic<uint64_t>* runs;
+    std::atomic<uint64_t>* done;
+    std::atomic<uint64_t>* filled;
+
+    void run() {
+        queue.try_add_local<Countdown>(steps, osca::queue::Status::Requeue,
+                                       runs, done, filled);
+    }
+};
+
+// adds `count` jobs that each run `steps` times, yielding or requeueing
+// between runs, while consumers run them
+// note: producer adds without pause so the queue stays full and requeueing
+//       jobs compete with it for slots
+auto run_test(uint32_t consumers, uint32_t count, uint32_t steps,
+              osca::queue::Status status) -> uint64_t {
+    std::atomic<uint64_t> runs{0};
+    std::atomic<uint64_t> done{0};
+    max_depth = 0;
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            stack_base = uintptr_t(__builtin_frame_address(0));
+            while (!st.stop_requested()) {
+                if (!queue.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (auto i = 0u; i < count; ++i) {
+        queue.add<Countdown>(steps, status, &runs, &done, nullptr);
+    }
+    queue.wait_idle();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = end_time - start_time;
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+    consumer_threads.clear();
+
+    // note: a consumer holds at most two unfinished jobs on its stack
+    auto const failures = uint64_t(runs.load() != uint64_t(count) * steps) +
+                          (done.load() != count) + (max_depth.load() > 4096);
+
+    auto const name =
+        status == osca::queue::Status::Yield ? "yield" : "requeue";
+    std::cout << "Results for " << name << " / " << consumers << "C:\n";
+    std::cout << "   Elapsed: " << elapsed.count() << " ms\n";
+    std::cout << "      Runs: " << runs.load() << " / "
+              << uint64_t(count) * steps << "\n";
+    std::cout << "      Done: " << done.load() << " / " << count << "\n";
+    std::cout << "     Stack: " << max_depth.load() << " bytes\n";
+    std::cout << "  Verified: " << (failures == 0 ? "yes" : "no")
+              << " (failures " << failures << ")\n\n";
+    return failures;
+}
+
+// runs a job from the core's local slot that requeues while the queue is
+// full, so the consumer must run waiting jobs to make room for it
+auto run_full(uint32_t steps) -> uint64_t {
+    std::atomic<uint64_t> runs{0};
+    std::atomic<uint64_t> done{0};
+    // counts plain jobs as they run, each added by the countdown
+    std::atomic<uint64_t> filled{0};
+    max_depth = 0;
+
+    current_core = 0;
+    stack_base = uintptr_t(__builtin_frame_address(0));
+
+    queue.add<Starter>(steps, &runs, &done, &filled);
+    while (queue.run_next(0)) {
+    }
+
+    auto const failures = uint64_t(runs.load() != steps) + (done.load() != 1) +
+                          (filled.load() == 0) + (queue.active_count() != 0) +
+                          (max_depth.load() > 4096);
+
+    std::cout << "Results for requeue on full queue / 1C:\n";
+    std::cout << "      Runs: " << runs.load() << " / " << steps << "\n";
+    std::cout << "    Filled: " << filled.load() << " plain jobs run\n";
+    std::cout << "     Stack: " << max_depth.load() << " bytes\n";
+    std::cout << "  Verified: " << (failures == 0 ? "yes" : "no")
+              << " (failures " << failures << ")\n\n";
+    return failures;
+}
+
+// adds single jobs that yield with nothing to yield to, so each runs again in
+// place, and checks that their tickets complete only when they are done and
+// that every run is accounted
+auto run_ticket(uint32_t consumers, uint32_t count, uint32_t steps)
+    -> uint64_t {
+    std::atomic<uint64_t> runs{0};
+    std::atomic<uint64_t> done{0};
+    auto failures = 0ull;
+
+    queue.set_costs(&costs);
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!queue.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    for (auto i = 0u; i < count; ++i) {
+        auto const ticket =
+            queue
+                .add<Countdown>(steps, osca::queue::Status::Yield, &runs,
+                                &done, nullptr)
+                .generation;
+        queue.wait_until(ticket);
+        failures += done.load() != i + 1;
+        failures += !queue.done(ticket);
+    }
+    queue.wait_idle();
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+    consumer_threads.clear();
+
+    queue.set_costs(nullptr);
+
+    osca::queue::Costs::Cost report[osca::queue::Costs::TYPES];
+    auto const types = costs.report(report, osca::queue::Costs::TYPES);
+    auto accounted = 0ull;
+    for (auto i = 0u; i < types; ++i) {
+        if (report[i].func == queue.func_of<Countdown>()) {
+            accounted = report[i].count;
+        }
+    }
+    failures += runs.load() != uint64_t(count) * steps;
+    failures += accounted != runs.load();
+
+    std::cout << "Results for ticket of job run in place / " << consumers
+              << "C:\n";
+    std::cout << "      Runs: " << runs.load() << " / "
+              << uint64_t(count) * steps << "\n";
+    std::cout << " Accounted: " << accounted << " runs\n";
+    std::cout << "  Verified: " << (failures == 0 ? "yes" : "no")
+              << " (failures " << failures << ")\n\n";
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t count = (argc > 2) ? std::stoi(argv[2]) : 20000;
+    uint32_t steps = (argc > 3) ? std::stoi(argv[3]) : 8;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "     Jobs: " << count << "\n";
+    std::cout << "    Steps: " << steps << "\n\n";
+
+    queue.init();
+
+    auto failures =
+        run_test(consumers, count, steps, osca::queue::Status::Yield);
+    failures += run_test(consumers, count, steps, osca::queue::Status::Requeue);
+    failures += run_full(steps);
+    failures += run_ticket(consumers, count / 100, steps);
+    return failures != 0;
+}
@@ -0,0 +1,116 @@
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// words of the buffer each chain works on
+auto constexpr CHAIN_WORDS = 64u * 1024 / sizeof(uint64_t);
+
+// a link in a chain of jobs working on the same buffer
+struct Link {
+    uint64_t* data;
+    uint32_t remaining;
+    bool local;
+    std::atomic<uint64_t>* counter;
+
+    void run() {
+        // read-modify-write the chain's buffer; cache is warm if the previous
+        // link ran on this core
+        auto sum = 0ull;
+        for (auto i = 0u; i < CHAIN_WORDS; ++i) {
+            data[i] += i;
+            sum += data[i];
+        }
+
+        // tells the compiler 'sum' is used here, don't optimize it away
+        asm volatile("" : : "g"(sum) : "memory");
+
+        counter->fetch_add(1, std::memory_order_relaxed);
+
+        if (remaining > 1) {
+            if (local) {
+                osca::jobs.add_local<Link>(data, remaining - 1, local, counter);
+            } else {
+                osca::jobs.add<Link>(data, remaining - 1, local, counter);
+            }
+        }
+    }
+};
+
+void run_test(uint32_t consumers, uint32_t chains, uint32_t length,
+              uint32_t rounds, bool local) {
+    std::atomic<uint64_t> completed_links{0};
+    std::vector<uint64_t> buffers(uint64_t(chains) * CHAIN_WORDS);
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // note: at most one link per chain is in the queue so chains must not
+    //       exceed queue size
+    for (auto r = 0u; r < rounds; ++r) {
+        for (auto i = 0u; i < chains; ++i) {
+            osca::jobs.add<Link>(&buffers[uint64_t(i) * CHAIN_WORDS], length,
+                                 local, &completed_links);
+        }
+        osca::jobs.wait_idle();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    auto const links = uint64_t(chains) * length * rounds;
+    std::cout << "Results for " << (local ? "local" : "global") << " / "
+              << consumers << "C:\n";
+    std::cout << "      Time: " << diff.count() << " s" << "\n";
+    std::cout << "Throughput: " << (links / diff.count()) << " links/sec\n";
+    std::cout << "  Verified: " << completed_links.load() << " / " << links
+              << "\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 1;
+    uint32_t chains = (argc > 2) ? std::stoi(argv[2]) : 64;
+    uint32_t length = (argc > 3) ? std::stoi(argv[3]) : 100;
+    uint32_t rounds = (argc > 4) ? std::stoi(argv[4]) : 10;
+    // 0: both, 1: global only, 2: local only
+    uint32_t mode = (argc > 5) ? std::stoi(argv[5]) : 0;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "   Chains: " << chains << "\n";
+    std::cout << "   Length: " << length << "\n";
+    std::cout << "   Rounds: " << rounds << "\n\n";
+
+    osca::jobs.init();
+
+    if (mode != 2) {
+        run_test(consumers, chains, length, rounds, false);
+    }
+    if (mode != 1) {
+        run_test(consumers, chains, length, rounds, true);
+    }
+}
@@ -0,0 +1,175 @@
+#include "osca.hpp"
+#include "task.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "test.hpp"
+
+// child task awaited by a flow
+auto square(uint64_t const x) -> osca::Task<uint64_t> { co_return x * x; }
+
+// async flow: wait for a job, fan out a group, await a child task, sleep and
+// reschedule before finishing
+auto flow(uint32_t const ticket, uint32_t const fan_out,
+          uint64_t const job_work, uint64_t const x,
+          std::atomic<uint64_t>* const jobs_done,
+          std::atomic<uint64_t>* const sum,
+          std::atomic<uint64_t>* const flows_done) -> osca::Task<> {
+    co_await osca::wait_until(ticket);
+
+    osca::Group group;
+    for (auto i = 0u; i < fan_out; ++i) {
+        group.add<Job>(x + i, job_work, jobs_done);
+    }
+    co_await group;
+
+    auto const value = co_await square(x);
+    co_await osca::sleep_for(1000);
+    co_await osca::schedule();
+
+    sum->fetch_add(value, std::memory_order_relaxed);
+    flows_done->fetch_add(1, std::memory_order_relaxed);
+}
+
+// awaits a child task created while the frame pool is exhausted
+auto parent(uint64_t const x) -> osca::Task<> { co_await square(x); }
+
+void run_test(uint32_t consumers, uint32_t flows, uint32_t fan_out,
+              uint64_t job_work) {
+    std::atomic<uint64_t> jobs_done{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> flows_done{0};
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    auto failed = 0u;
+    for (auto i = 0u; i < flows; ++i) {
+        // each flow starts after a job it depends on
+        auto const ticket =
+            osca::jobs.add<Job>(uint64_t(i), job_work, &jobs_done).generation;
+        if (!osca::spawn(flow(ticket, fan_out, job_work, i, &jobs_done, &sum,
+                              &flows_done))) {
+            ++failed;
+        }
+    }
+    osca::jobs.wait_idle();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    auto expected_sum = 0ull;
+    for (auto i = 0ull; i < flows; ++i) {
+        expected_sum += i * i;
+    }
+    auto const expected_jobs = uint64_t(flows) * (fan_out + 1);
+
+    std::cout << "Results for " << consumers << "C:\n";
+    std::cout << "      Time: " << diff.count() << " s" << "\n";
+    std::cout << "Throughput: " << (flows / diff.count()) << " flows/sec\n";
+    std::cout << "     Flows: " << flows_done.load() << " / " << flows
+              << (failed ? " (frame allocation failed)" : "") << "\n";
+    std::cout << "      Jobs: " << jobs_done.load() << " / " << expected_jobs
+              << "\n";
+    std::cout << "       Sum: " << sum.load() << " / " << expected_sum
+              << "\n\n";
+}
+
+// exhausts the frame pool after a parent task got its frame, then runs the
+// parent which awaits a child whose frame could not be allocated; that must
+// panic, so it runs in a child process whose frame buffer is shared
+auto run_exhausted() -> uint64_t {
+    auto constexpr WIDTH = 64u;
+    auto constexpr HEIGHT = 4u;
+    auto constexpr PANIC_COLOR = 0xff00ffu;
+
+    auto* const pixels = static_cast<uint32_t*>(
+        mmap(nullptr, WIDTH * HEIGHT * sizeof(uint32_t),
+             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    std::fill(pixels, pixels + WIDTH * HEIGHT, 0u);
+
+    auto const pid = fork();
+    if (pid == 0) {
+        current_core = 0;
+        kernel::frame_buffer = {pixels, WIDTH, HEIGHT, WIDTH};
+
+        auto task = parent(7);
+
+        for (auto cls = 0u; cls < osca::frames::CLASS_COUNT; ++cls) {
+            auto const size = size_t(osca::frames::MIN_SIZE) << cls;
+            while (osca::frames::allocate(size)) {
+            }
+        }
+
+        osca::spawn(std::move(task));
+        while (osca::jobs.run_next(current_core)) {
+        }
+
+        // note: reached only if awaiting did not panic
+        _exit(0);
+    }
+
+    auto status = 0;
+    waitpid(pid, &status, 0);
+
+    auto painted = 0u;
+    for (auto i = 0u; i < WIDTH * HEIGHT; ++i) {
+        painted += pixels[i] == PANIC_COLOR;
+    }
+    munmap(pixels, WIDTH * HEIGHT * sizeof(uint32_t));
+
+    auto const exited = WIFEXITED(status);
+    auto const failures = uint64_t(exited) + (painted != WIDTH * HEIGHT);
+
+    std::cout << "Results for exhausted frames:\n";
+    std::cout << "     Child: " << (exited ? "exited" : "terminated")
+              << ", frame buffer " << painted << " / " << WIDTH * HEIGHT
+              << " pixels in panic color\n";
+    std::cout << "  Verified: " << (failures == 0 ? "yes" : "no")
+              << " (failures " << failures << ")\n\n";
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t flows = (argc > 2) ? std::stoi(argv[2]) : 10000;
+    uint32_t fan_out = (argc > 3) ? std::stoi(argv[3]) : 8;
+    uint64_t job_work = (argc > 4) ? std::stoull(argv[4]) : 1000;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "    Flows: " << flows << "\n";
+    std::cout << "  Fan out: " << fan_out << "\n";
+    std::cout << " Job work: " << job_work << "\n\n";
+
+    osca::jobs.init();
+
+    run_test(consumers, flows, fan_out, job_work);
+    return run_exhausted() != 0;
+}
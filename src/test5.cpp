@@ -0,0 +1,152 @@
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// job that records whether it finished before its deadline
+struct Timed {
+    uint64_t deadline;
+    uint64_t work;
+    std::atomic<uint64_t>* missed;
+    std::atomic<uint64_t>* completed;
+
+    void run() {
+        auto val = deadline;
+        for (auto i = 0u; i < work; ++i) {
+            val = ((val << 5) + val) + i;
+        }
+
+        // tells the compiler 'val' is used here, don't optimize it away
+        asm volatile("" : : "g"(val) : "memory");
+
+        if (kernel::core::rdtsc() > deadline) {
+            missed->fetch_add(1, std::memory_order_relaxed);
+        }
+        completed->fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+// deadline lane sized like the fifo queue for the same load
+osca::queue::Edf<256, 64> lane;
+
+// rdtsc ticks per microsecond
+uint64_t ticks_per_us() {
+    auto const start = std::chrono::steady_clock::now();
+    auto const t0 = kernel::core::rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto const t1 = kernel::core::rdtsc();
+    std::chrono::duration<double, std::micro> us =
+        std::chrono::steady_clock::now() - start;
+    return uint64_t((t1 - t0) / us.count());
+}
+
+// each frame adds a burst of jobs of which `urgent` are due within a quarter
+// of the period and the rest within ten periods, urgent ones spread over the
+// burst
+void run_test(uint32_t consumers, uint32_t frames, uint32_t burst,
+              uint32_t urgent, uint64_t work, uint64_t period_us,
+              uint64_t period, bool edf) {
+    std::atomic<uint64_t> missed{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> urgent_missed{0};
+    std::atomic<uint64_t> urgent_completed{0};
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i, edf](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                auto const ran =
+                    edf ? lane.run_next(i) : osca::jobs.run_next(i);
+                if (!ran) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    // note: producer sleeps between frames like a timer interrupt would
+    auto rng = 12345u;
+    auto next_frame = std::chrono::steady_clock::now();
+    for (auto f = 0u; f < frames; ++f) {
+        std::this_thread::sleep_until(next_frame);
+        next_frame += std::chrono::microseconds(period_us);
+        auto const now = kernel::core::rdtsc();
+
+        auto urgent_left = urgent;
+        for (auto i = 0u; i < burst; ++i) {
+            rng = rng * 1664525 + 1013904223;
+            auto const is_urgent =
+                urgent_left > 0 &&
+                (rng >> 8) % (burst - i) < urgent_left;
+            urgent_left -= is_urgent;
+
+            auto const deadline = now + (is_urgent ? period / 4 : period * 10);
+            auto* const m = is_urgent ? &urgent_missed : &missed;
+            auto* const c = is_urgent ? &urgent_completed : &completed;
+            if (edf) {
+                lane.add<Timed>(deadline, deadline, work, m, c);
+            } else {
+                osca::jobs.add<Timed>(deadline, work, m, c);
+            }
+        }
+    }
+
+    if (edf) {
+        lane.wait_idle();
+    } else {
+        osca::jobs.wait_idle();
+    }
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    auto const total = completed.load() + urgent_completed.load();
+    auto const total_missed = missed.load() + urgent_missed.load();
+
+    std::cout << "Results for " << (edf ? "edf" : "fifo") << " / "
+              << consumers << "C:\n";
+    std::cout << "    Missed: " << total_missed << " / " << total << " ("
+              << 100.0 * total_missed / total << " %)\n";
+    std::cout << "    Urgent: " << urgent_missed.load() << " / "
+              << urgent_completed.load() << " ("
+              << 100.0 * urgent_missed.load() / urgent_completed.load()
+              << " %)\n";
+    std::cout << "  Verified: " << total << " / " << uint64_t(frames) * burst
+              << "\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t frames = (argc > 2) ? std::stoi(argv[2]) : 200;
+    uint32_t burst = (argc > 3) ? std::stoi(argv[3]) : 64;
+    uint32_t urgent = (argc > 4) ? std::stoi(argv[4]) : 8;
+    uint64_t work = (argc > 5) ? std::stoull(argv[5]) : 10000;
+    uint64_t period_us = (argc > 6) ? std::stoull(argv[6]) : 2000;
+
+    auto const period = period_us * ticks_per_us();
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "   Frames: " << frames << "\n";
+    std::cout << "    Burst: " << burst << "\n";
+    std::cout << "   Urgent: " << urgent << "\n";
+    std::cout << "     Work: " << work << "\n";
+    std::cout << "   Period: " << period_us << " us\n\n";
+
+    osca::jobs.init();
+    // note: the producer's core index is past the count and extends it
+    lane.init(consumers);
+
+    run_test(consumers, frames, burst, urgent, work, period_us, period, false);
+    run_test(consumers, frames, burst, urgent, work, period_us, period, true);
+}
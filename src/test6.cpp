@@ -0,0 +1,134 @@
+#include "governor.hpp"
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// load phase: `jobs` spread evenly over `ms` milliseconds
+struct Phase {
+    char const* name;
+    uint32_t jobs;
+    uint32_t ms;
+};
+
+void run_test(uint32_t consumers, uint64_t job_work, bool governed) {
+    Phase const phases[] = {
+        {"idle", 100, 200},
+        {"peak", 200000, 200},
+        {"idle", 100, 200},
+    };
+
+    std::atomic<uint64_t> completed_jobs{0};
+    std::vector<std::atomic<uint64_t>> parked_ticks(consumers);
+
+    // a governor that never parks when not `governed`
+    osca::governor.init(osca::jobs, governed ? 1 : consumers, consumers, 4, 1,
+                        20);
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i, &parked_ticks](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (osca::jobs.run_next(i)) {
+                    continue;
+                }
+                if (!osca::governor.parked(i)) {
+                    kernel::core::pause();
+                    continue;
+                }
+                auto const start = kernel::core::rdtsc();
+                osca::governor.park(i);
+                parked_ticks[i].fetch_add(kernel::core::rdtsc() - start,
+                                          std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // monitor stands in for `on_timer`, sampling every 100 us
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> active_sum{0};
+    std::jthread monitor([&](std::stop_token st) {
+        while (!st.stop_requested()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            osca::governor.update();
+            samples.fetch_add(1, std::memory_order_relaxed);
+            active_sum.fetch_add(osca::governor.active_consumers(),
+                                 std::memory_order_relaxed);
+        }
+    });
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    std::cout << "Results for " << (governed ? "governed" : "always on")
+              << " / " << consumers << "C:\n";
+
+    auto const run_start = kernel::core::rdtsc();
+    auto total_jobs = 0ull;
+    for (auto const& phase : phases) {
+        auto const samples_start = samples.load();
+        auto const active_start = active_sum.load();
+        auto const start = std::chrono::steady_clock::now();
+        auto const interval = std::chrono::microseconds(phase.ms * 1000) /
+                              phase.jobs;
+
+        for (auto i = 0u; i < phase.jobs; ++i) {
+            osca::jobs.add<Job>(uint64_t(i), job_work, &completed_jobs);
+            // note: peak adds as fast as the queue accepts
+            if (interval > std::chrono::microseconds(50)) {
+                std::this_thread::sleep_until(start + interval * (i + 1));
+            }
+        }
+        osca::jobs.wait_idle();
+        total_jobs += phase.jobs;
+
+        std::chrono::duration<double> diff =
+            std::chrono::steady_clock::now() - start;
+        auto const n = samples.load() - samples_start;
+        std::cout << "    " << phase.name << ": " << phase.jobs / diff.count()
+                  << " jobs/sec, active "
+                  << (n ? double(active_sum.load() - active_start) / n : 0.0)
+                  << "\n";
+    }
+    auto const run_ticks = kernel::core::rdtsc() - run_start;
+
+    monitor.request_stop();
+    monitor.join();
+    osca::governor.activate_all();
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+    for (auto& c : consumer_threads) {
+        c.join();
+    }
+
+    auto parked = 0ull;
+    for (auto& p : parked_ticks) {
+        parked += p.load();
+    }
+
+    std::cout << "    Parked: " << 100.0 * parked / (run_ticks * consumers)
+              << " % of consumer time\n";
+    std::cout << "  Verified: " << completed_jobs.load() << " / " << total_jobs
+              << "\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint64_t job_work = (argc > 2) ? std::stoull(argv[2]) : 1000;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << " Job work: " << job_work << "\n\n";
+
+    osca::jobs.init();
+
+    run_test(consumers, job_work, false);
+    run_test(consumers, job_work, true);
+}
@@ -0,0 +1,130 @@
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// job types with different costs
+template <uint32_t Work> struct Spin {
+    uint64_t payload;
+    std::atomic<uint64_t>* counter;
+
+    void run() {
+        auto val = payload;
+        for (auto i = 0u; i < Work; ++i) {
+            val = ((val << 5) + val) + i;
+        }
+
+        // tells the compiler 'val' is used here, don't optimize it away
+        asm volatile("" : : "g"(val) : "memory");
+
+        counter->fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+using Light = Spin<100>;
+using Medium = Spin<1000>;
+using Heavy = Spin<10000>;
+
+osca::queue::Costs costs;
+
+auto name_of(void const* func) -> char const* {
+    using Queue = decltype(osca::jobs);
+    if (func == Queue::func_of<Light>()) {
+        return "Light";
+    }
+    if (func == Queue::func_of<Medium>()) {
+        return "Medium";
+    }
+    if (func == Queue::func_of<Heavy>()) {
+        return "Heavy";
+    }
+    return "?";
+}
+
+// adds jobs in ratio 100 light : 10 medium : 1 heavy
+void run_test(uint32_t consumers, uint32_t rounds, bool accounting) {
+    std::atomic<uint64_t> completed_jobs{0};
+
+    osca::jobs.set_costs(accounting ? &costs : nullptr);
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (auto r = 0u; r < rounds; ++r) {
+        for (auto i = 0u; i < 100; ++i) {
+            osca::jobs.add<Light>(uint64_t(i), &completed_jobs);
+        }
+        for (auto i = 0u; i < 10; ++i) {
+            osca::jobs.add<Medium>(uint64_t(i), &completed_jobs);
+        }
+        osca::jobs.add<Heavy>(uint64_t(r), &completed_jobs);
+    }
+    osca::jobs.wait_idle();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+    for (auto& c : consumer_threads) {
+        c.join();
+    }
+
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    auto const jobs = uint64_t(rounds) * 111;
+    std::cout << "Results for " << (accounting ? "accounting" : "plain")
+              << " / " << consumers << "C:\n";
+    std::cout << "      Time: " << diff.count() << " s" << "\n";
+    std::cout << "Throughput: " << (jobs / diff.count()) << " jobs/sec\n";
+    std::cout << "  Verified: " << completed_jobs.load() << " / " << jobs
+              << "\n";
+
+    if (accounting) {
+        osca::queue::Costs::Cost report[osca::queue::Costs::TYPES];
+        auto const n = costs.report(report, osca::queue::Costs::TYPES);
+        auto total = 0ull;
+        for (auto i = 0u; i < n; ++i) {
+            total += report[i].cycles;
+        }
+        std::cout << "     Costs:\n";
+        for (auto i = 0u; i < n; ++i) {
+            std::cout << "        " << name_of(report[i].func) << " ("
+                      << report[i].func << "): " << report[i].count
+                      << " jobs, " << report[i].cycles << " cycles, "
+                      << report[i].cycles / report[i].count << " avg, "
+                      << 100.0 * report[i].cycles / total << " %\n";
+        }
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t rounds = (argc > 2) ? std::stoi(argv[2]) : 1000;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "   Rounds: " << rounds << "\n\n";
+
+    osca::jobs.init();
+
+    run_test(consumers, rounds, false);
+    run_test(consumers, rounds, true);
+}
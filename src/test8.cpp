@@ -0,0 +1,150 @@
+#include "pages.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+auto kernel::allocate_pages(u64 const num_pages) -> void* {
+    return kernel::pages::allocate_pages(num_pages);
+}
+
+// synthetic memory map over host memory standing in for physical memory
+// note: firmware descriptors are commonly 48 bytes apart
+struct alignas(8) RawDescriptor {
+    kernel::pages::Descriptor d;
+    uint64_t padding;
+};
+
+std::vector<RawDescriptor> descriptors;
+
+// returns usable pages in the map
+uint64_t build_memory_map(uint8_t* memory, uint64_t pages) {
+    auto const page = kernel::pages::PAGE_SIZE;
+    auto usable = 0ull;
+    auto add = [&](uint32_t type, uint64_t first, uint64_t count) {
+        RawDescriptor raw{};
+        raw.d.type = type;
+        raw.d.physical_start = uint64_t(memory + first * page);
+        raw.d.virtual_start = raw.d.physical_start;
+        raw.d.number_of_pages = count;
+        descriptors.push_back(raw);
+        if (type == kernel::pages::CONVENTIONAL_MEMORY) {
+            usable += count;
+        }
+    };
+
+    // layout in pages: unaligned conventional, loader data, boot services
+    // data, then the rest conventional in two adjacent descriptors
+    add(kernel::pages::CONVENTIONAL_MEMORY, 3, 1021);
+    add(2, 1024, 256);
+    add(kernel::pages::BOOT_SERVICES_DATA, 1280, 768);
+    auto const rest = pages - 2048;
+    add(kernel::pages::CONVENTIONAL_MEMORY, 2048, rest / 2);
+    add(kernel::pages::CONVENTIONAL_MEMORY, 2048 + rest / 2, rest - rest / 2);
+
+    kernel::memory_map.buffer = descriptors.data();
+    kernel::memory_map.size = descriptors.size() * sizeof(RawDescriptor);
+    kernel::memory_map.descriptor_size = sizeof(RawDescriptor);
+    kernel::memory_map.descriptor_version = 1;
+
+    return usable;
+}
+
+// each thread allocates `batch` pages of `num_pages`, tags them, verifies the
+// tags and frees them, `rounds` times
+void run_test(uint32_t threads, uint32_t rounds, uint32_t batch,
+              uint64_t num_pages, bool cached) {
+    std::atomic<uint64_t> operations{0};
+    std::atomic<uint64_t> failures{0};
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::jthread> workers;
+    for (auto t = 0u; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            current_core = t;
+            std::vector<uint64_t*> pages(batch);
+            auto const order = kernel::pages::order_of(num_pages);
+            for (auto r = 0u; r < rounds; ++r) {
+                for (auto& p : pages) {
+                    p = ptr<uint64_t>(cached ? kernel::allocate_pages(num_pages)
+                                             : kernel::pages::allocate(order));
+                    if (p == nullptr) {
+                        failures.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    *p = (uint64_t(t) << 32) | r;
+                }
+                for (auto& p : pages) {
+                    if (p == nullptr) {
+                        continue;
+                    }
+                    if (*p != ((uint64_t(t) << 32) | r)) {
+                        failures.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    if (cached) {
+                        kernel::pages::free_pages(p, num_pages);
+                    } else {
+                        kernel::pages::free(p, order);
+                    }
+                }
+                operations.fetch_add(batch, std::memory_order_relaxed);
+            }
+            kernel::pages::drain();
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    std::cout << "Results for " << num_pages << " page(s) "
+              << (cached ? "cached" : "buddy") << " / " << threads << "T:\n";
+    std::cout << "      Time: " << diff.count() << " s" << "\n";
+    std::cout << "Throughput: " << (operations / diff.count())
+              << " alloc+free/sec\n";
+    std::cout << "  Failures: " << failures.load() << "\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t threads = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t rounds = (argc > 2) ? std::stoi(argv[2]) : 10000;
+    uint32_t batch = (argc > 3) ? std::stoi(argv[3]) : 16;
+    uint64_t memory_mb = (argc > 4) ? std::stoull(argv[4]) : 64;
+
+    auto const pages = memory_mb * 1024 * 1024 / kernel::pages::PAGE_SIZE;
+    auto* const memory = static_cast<uint8_t*>(std::aligned_alloc(
+        kernel::pages::PAGE_SIZE << kernel::pages::MAX_ORDER,
+        pages * kernel::pages::PAGE_SIZE));
+
+    std::cout << "  Threads: " << threads << "\n";
+    std::cout << "   Rounds: " << rounds << "\n";
+    std::cout << "    Batch: " << batch << "\n";
+    std::cout << "   Memory: " << memory_mb << " MB\n\n";
+
+    auto const usable = build_memory_map(memory, pages);
+    kernel::pages::init(false);
+
+    // orders table takes a byte per page from the aligned start of memory
+    auto const table_pages =
+        (pages + kernel::pages::PAGE_SIZE - 1) / kernel::pages::PAGE_SIZE;
+    auto const available = kernel::pages::available();
+    std::cout << "Available: " << available << " / " << usable - table_pages
+              << " pages\n\n";
+
+    run_test(threads, rounds, batch, 1, true);
+    run_test(threads, rounds, batch, 1, false);
+    run_test(threads, rounds / 10, batch, 8, true);
+
+    // all blocks merged back
+    std::cout << " Restored: " << kernel::pages::available() << " / "
+              << available << " pages\n";
+
+    std::free(memory);
+}
@@ -0,0 +1,145 @@
+#include "alloc.hpp"
+#include "osca.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+// job that checks and frees a block allocated by the producer
+struct Release {
+    uint64_t* block;
+    uint64_t tag;
+    bool system;
+    std::atomic<uint64_t>* completed;
+    std::atomic<uint64_t>* failures;
+
+    void run() {
+        if (*block != tag) {
+            failures->fetch_add(1, std::memory_order_relaxed);
+        }
+        if (system) {
+            std::free(block);
+        } else {
+            kernel::alloc::free(block);
+        }
+        completed->fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+// sizes cycled through by the producer
+uint32_t constexpr SIZES[] = {16, 24, 48, 64, 100, 128, 200, 256, 500, 1000};
+
+// producer allocates and tags blocks, consumers free them
+void run_test(uint32_t consumers, uint32_t blocks, bool system) {
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> failures{0};
+
+    // launch consumers, each on its own core index
+    std::vector<std::jthread> consumer_threads;
+    for (auto i = 0u; i < consumers; ++i) {
+        consumer_threads.emplace_back([i](std::stop_token st) {
+            current_core = i;
+            while (!st.stop_requested()) {
+                if (!osca::jobs.run_next(i)) {
+                    kernel::core::pause();
+                }
+            }
+        });
+    }
+
+    // producer core index is after consumers
+    current_core = consumers;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    auto failed = 0u;
+    for (auto i = 0u; i < blocks; ++i) {
+        auto const size = SIZES[i % (sizeof(SIZES) / sizeof(SIZES[0]))];
+        auto* const block = ptr<uint64_t>(
+            system ? std::malloc(size) : kernel::alloc::allocate(size));
+        if (block == nullptr) {
+            ++failed;
+            continue;
+        }
+        *block = i;
+        osca::jobs.add<Release>(block, uint64_t(i), system, &completed,
+                                &failures);
+    }
+    osca::jobs.wait_idle();
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    for (auto& c : consumer_threads) {
+        c.request_stop();
+    }
+
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    std::cout << "Results for " << (system ? "malloc" : "kernel::alloc")
+              << " / " << consumers << "C:\n";
+    std::cout << "      Time: " << diff.count() << " s" << "\n";
+    std::cout << "Throughput: " << (blocks / diff.count())
+              << " alloc+free/sec\n";
+    std::cout << "  Verified: " << completed.load() << " / " << blocks
+              << " (failures " << failures.load() + failed << ")\n\n";
+}
+
+// allocates and frees on the same core in batches
+void run_local(uint32_t rounds, bool system) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    void* blocks[64];
+    for (auto r = 0u; r < rounds; ++r) {
+        for (auto i = 0u; i < 64; ++i) {
+            auto const size = SIZES[i % (sizeof(SIZES) / sizeof(SIZES[0]))];
+            blocks[i] = system ? std::malloc(size)
+                               : kernel::alloc::allocate(size);
+            asm volatile("" : : "g"(blocks[i]) : "memory");
+        }
+        for (auto* block : blocks) {
+            if (system) {
+                std::free(block);
+            } else {
+                kernel::alloc::free(block);
+            }
+        }
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end_time - start_time;
+
+    std::cout << "Results for " << (system ? "malloc" : "kernel::alloc")
+              << " same core:\n";
+    std::cout << "Throughput: " << (rounds * 64.0 / diff.count())
+              << " alloc+free/sec\n\n";
+}
+
+int main(int argc, char** argv) {
+    uint32_t consumers = (argc > 1) ? std::stoi(argv[1]) : 4;
+    uint32_t blocks = (argc > 2) ? std::stoi(argv[2]) : 1000000;
+    uint64_t heap_mb = (argc > 3) ? std::stoull(argv[3]) : 64;
+
+    std::cout << "Consumers: " << consumers << "\n";
+    std::cout << "   Blocks: " << blocks << "\n";
+    std::cout << "     Heap: " << heap_mb << " MB\n\n";
+
+    kernel::heap.size = heap_mb * 1024 * 1024;
+    kernel::heap.start = std::aligned_alloc(4096, kernel::heap.size);
+    kernel::alloc::init(consumers + 1);
+
+    osca::jobs.init();
+
+    run_test(consumers, blocks, true);
+    run_test(consumers, blocks, false);
+
+    current_core = consumers;
+    run_local(blocks / 64, true);
+    run_local(blocks / 64, false);
+
+    std::free(kernel::heap.start);
+}
@@ -11,6 +11,7 @@ using i64 = long long;
 using f32 = float;
 using f64 = double;
 using uptr = u64;
+using usize = decltype(sizeof(0));
 
 // shorthand for pointer casts
 
@@ -73,3 +74,8 @@ auto constexpr inline fwd(typename remove_reference<T>::type&& t) noexcept
     -> T&& {
     return static_cast<T&&>(t);
 }
+
+// excludes a parameter from template argument deduction
+template <typename T> struct type_identity {
+    using type = T;
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include "atomic.hpp"
+#include "kernel.hpp"
+#include "types.hpp"
+
+//
+// interrupt-driven 16550 uart transmitter
+//
+// writers copy bytes into a transmit ring; whenever the transmitter holding
+// register is empty up to `FIFO_SIZE` bytes are moved from the ring to the
+// fifo in one burst, by the writer that finds the transmitter idle or by the
+// interrupt raised when the fifo drains
+//
+// `Port` supplies port i/o and interrupt masking so that the driver can run
+// against a simulated port on the host:
+//   auto out(u16 port, u8 value) -> void;
+//   auto in(u16 port) -> u8;
+//   auto disable_interrupts() -> bool;    // returns true if were enabled
+//   auto restore_interrupts(bool enabled) -> void;
+//
+// usage:
+//   kernel at start:
+//     uart::com1.init(uart::COM1, uart::divisor_of(115200));
+//     log::set_sink([](u8 const* data, u32 size) {
+//         uart::com1.write(data, size);
+//     });
+//   interrupt handler of the uart's irq (4 for com1):
+//     uart::com1.on_interrupt();
+//
+// thread safety:
+//  * init(): once before any other call
+//  * write(), poll(), flush(): any core
+//  * on_interrupt(): interrupt handler of the uart
+//
+// constraints:
+//  * bytes that do not fit in the ring are not written, see `write`
+//
+namespace kernel::uart {
+
+auto constexpr COM1 = u16(0x3f8);
+
+// bytes the transmit fifo holds
+auto constexpr FIFO_SIZE = 16u;
+
+// bytes in the transmit ring
+auto constexpr TX_SIZE = 4096u;
+
+static_assert((TX_SIZE & (TX_SIZE - 1)) == 0, "power of 2");
+
+// register offsets from the base port
+auto constexpr THR = u16(0); // transmitter holding (write)
+auto constexpr DLL = u16(0); // divisor latch low (dlab set)
+auto constexpr IER = u16(1); // interrupt enable
+auto constexpr DLM = u16(1); // divisor latch high (dlab set)
+auto constexpr IIR = u16(2); // interrupt identification (read)
+auto constexpr FCR = u16(2); // fifo control (write)
+auto constexpr LCR = u16(3); // line control
+auto constexpr MCR = u16(4); // modem control
+auto constexpr LSR = u16(5); // line status
+
+auto constexpr IER_THRE = u8(0x02);
+auto constexpr IIR_NONE = u8(0x01);
+auto constexpr IIR_THRE = u8(0x02);
+auto constexpr IIR_MASK = u8(0x0e);
+// enable and clear both fifos
+auto constexpr FCR_ENABLE = u8(0x07);
+auto constexpr LCR_DLAB = u8(0x80);
+// 8 data bits, no parity, 1 stop bit
+auto constexpr LCR_8N1 = u8(0x03);
+// dtr, rts and out2 that gates the interrupt line
+auto constexpr MCR_DTR_RTS_OUT2 = u8(0x0b);
+// transmitter holding register, and so the fifo, empty
+auto constexpr LSR_THRE = u8(0x20);
+
+// returns divisor of the 115200 base clock for `baud`
+auto constexpr divisor_of(u32 const baud) -> u16 { return u16(115200 / baud); }
+
+// port i/o and interrupt masking of the processor
+struct IoPort {
+    auto out(u16 const port, u8 const value) -> void { outb(port, value); }
+    auto in(u16 const port) -> u8 { return inb(port); }
+
+    auto disable_interrupts() -> bool {
+        u64 flags;
+        asm volatile("pushfq; pop %0; cli" : "=r"(flags) : : "memory");
+        // interrupt flag
+        return flags & (1u << 9);
+    }
+
+    auto restore_interrupts(bool const enabled) -> void {
+        if (enabled) {
+            core::interrupts_enable();
+        }
+    }
+};
+
+template <typename Port> class Uart16550 final {
+    Port port_;
+    u16 base_;
+
+    // guards the ring and the device
+    // note: held with interrupts disabled so that `on_interrupt` on the same
+    //       core cannot spin on it
+    atomic::Spinlock lock_;
+
+    u8 ring_[TX_SIZE];
+    // bytes from `tail_` to `head_` wait for the fifo
+    u32 head_;
+    u32 tail_;
+    // true while the fifo empty interrupt is enabled
+    bool interrupt_;
+
+    // bytes not written because the ring was full
+    // note: written with lock held, read by `dropped`
+    u64 dropped_;
+
+  public:
+    // configures the uart at `base` for 8n1 at 115200 / `divisor` baud with
+    // fifos enabled
+    auto init(u16 const base, u16 const divisor) -> void {
+        base_ = base;
+        head_ = 0;
+        tail_ = 0;
+        interrupt_ = false;
+        dropped_ = 0;
+
+        port_.out(base_ + IER, 0);
+        port_.out(base_ + LCR, LCR_DLAB);
+        port_.out(base_ + DLL, u8(divisor));
+        port_.out(base_ + DLM, u8(divisor >> 8));
+        port_.out(base_ + LCR, LCR_8N1);
+        port_.out(base_ + FCR, FCR_ENABLE);
+        port_.out(base_ + MCR, MCR_DTR_RTS_OUT2);
+    }
+
+    // returns the port, for example a simulated one
+    auto port() -> Port& { return port_; }
+
+    // copies `size` bytes at `data` to the ring and starts transmitting
+    // returns:
+    //   bytes accepted, less than `size` if the ring is full
+    auto write(u8 const* const data, u32 const size) -> u32 {
+        auto const enabled = port_.disable_interrupts();
+        lock_.lock();
+
+        auto const free = TX_SIZE - (head_ - tail_);
+        auto const count = size < free ? size : free;
+        for (auto i = 0u; i < count; ++i) {
+            ring_[(head_ + i) & (TX_SIZE - 1)] = data[i];
+        }
+        head_ += count;
+        if (count < size) {
+            atomic::store(&dropped_, dropped_ + size - count, atomic::RELAXED);
+        }
+
+        // note: while the fifo empty interrupt is enabled `on_interrupt`
+        //       refills, so the device is touched only to start an idle
+        //       transmitter
+        if (!interrupt_ && (port_.in(base_ + LSR) & LSR_THRE)) {
+            refill();
+        }
+
+        lock_.unlock();
+        port_.restore_interrupts(enabled);
+        return count;
+    }
+
+    // called from the interrupt handler
+    // refills the fifo if it drained
+    auto on_interrupt() -> void {
+        lock_.lock();
+        auto const iir = port_.in(base_ + IIR);
+        if (!(iir & IIR_NONE) && (iir & IIR_MASK) == IIR_THRE) {
+            refill();
+        }
+        lock_.unlock();
+    }
+
+    // refills the fifo if it drained, for use without the interrupt, for
+    // example from the timer
+    auto poll() -> void {
+        auto const enabled = port_.disable_interrupts();
+        lock_.lock();
+        if (port_.in(base_ + LSR) & LSR_THRE) {
+            refill();
+        }
+        lock_.unlock();
+        port_.restore_interrupts(enabled);
+    }
+
+    // transmits the ring busy-waiting on the fifo
+    // note: for `panic` and before the interrupt is routed
+    auto flush() -> void {
+        while (true) {
+            auto const enabled = port_.disable_interrupts();
+            lock_.lock();
+            auto const empty = head_ == tail_;
+            if (!empty && (port_.in(base_ + LSR) & LSR_THRE)) {
+                refill();
+            }
+            lock_.unlock();
+            port_.restore_interrupts(enabled);
+            if (empty) {
+                return;
+            }
+            core::pause();
+        }
+    }
+
+    // returns bytes waiting in the ring
+    auto pending() -> u32 {
+        auto const enabled = port_.disable_interrupts();
+        lock_.lock();
+        auto const count = head_ - tail_;
+        lock_.unlock();
+        port_.restore_interrupts(enabled);
+        return count;
+    }
+
+    // returns bytes not written because the ring was full
+    // note: intended to be used in status displays etc
+    auto dropped() const -> u64 {
+        return atomic::load(&dropped_, atomic::RELAXED);
+    }
+
+  private:
+    // moves up to `FIFO_SIZE` bytes from the ring to the empty fifo and
+    // enables the fifo empty interrupt while bytes remain
+    // note: called with lock held
+    auto refill() -> void {
+        auto count = head_ - tail_;
+        count = count < FIFO_SIZE ? count : FIFO_SIZE;
+        for (auto i = 0u; i < count; ++i) {
+            port_.out(base_ + THR, ring_[tail_ & (TX_SIZE - 1)]);
+            ++tail_;
+        }
+
+        auto const remaining = head_ != tail_;
+        if (remaining != interrupt_) {
+            interrupt_ = remaining;
+            port_.out(base_ + IER, remaining ? IER_THRE : 0);
+        }
+    }
+};
+
+Uart16550<IoPort> inline com1;
+
+} // namespace kernel::uart
@@ -5,3 +5,17 @@ cp ../uefi-os/src/types.hpp src/
 cp ../uefi-os/src/atomic.hpp src/
 cp ../uefi-os/src/kernel.hpp src/
 cp ../uefi-os/src/osca.hpp src/
+cp ../uefi-os/src/coroutine.hpp src/
+cp ../uefi-os/src/task.hpp src/
+cp ../uefi-os/src/governor.hpp src/
+cp ../uefi-os/src/pages.hpp src/
+cp ../uefi-os/src/alloc.hpp src/
+cp ../uefi-os/src/pool.hpp src/
+cp ../uefi-os/src/cpu.hpp src/
+cp ../uefi-os/src/memory.hpp src/
+cp ../uefi-os/src/parallel.hpp src/
+cp ../uefi-os/src/log.hpp src/
+cp ../uefi-os/src/uart.hpp src/
+cp ../uefi-os/src/format.hpp src/
+cp ../uefi-os/src/graphics.hpp src/
+cp ../uefi-os/src/render.hpp src/